@@ -8,6 +8,7 @@ Copyright 2022 NXP
 import binascii
 import logging
 import os
+import select
 import struct
 import sys
 import threading
@@ -17,9 +18,14 @@ import time
 LOGGER = logging.getLogger(__name__)
 logging.basicConfig(stream=sys.stdout, level=logging.DEBUG)
 
-# Time between idps collect
+# Time between checks for the IPCF character device, while it is not available,
+# also used as the maximum time spent waiting for new data on the device
 IDPS_COLLECT_INTERVAL = 1
 
+# Size of the buffer used for a single read from the IPCF character device, it shall
+# fit at least the largest message of the channel, including its size
+IDPS_READ_SIZE = 65536
+
 # IDPS data expiration interval. If statistics are not read within this time frame
 # the statistics will be deleted.
 IDPS_DATA_EXPIRATION_INTERVAL = 60
@@ -53,7 +59,7 @@ class CanIdpsStats:
         # marker for ipcf device driver availability
         self.__ipcf_dev_available = False
         self.__reset_stats()
-        self.__collect_stats()
+        threading.Thread(target=self.__collect_stats, daemon=True).start()
 
     def __reset_stats(self):
         """
@@ -136,30 +142,67 @@ class CanIdpsStats:
 
         return idps_statistics
 
+    def __read_pending_data(self, dev_fd):
+        """
+        Reads all the messages currently queued in the IPCF character device driver
+        :param dev_fd: file descriptor of the device, opened in non-blocking mode
+        :returns: byte array containing the concatenated messages
+        """
+        raw_data = b""
+        while True:
+            try:
+                data = os.read(dev_fd, IDPS_READ_SIZE)
+            except BlockingIOError:
+                break
+            if not data:
+                break
+            raw_data += data
+        return raw_data
+
     def __collect_stats(self):
         """
-        Statistic collector, this function runs every IDPS_COLLECT_INTERVAL.
-        This function checks if any new data was received on the CAN_STATS_DEV.
-        In case new data was received, the function will save data in the stats variable.
+        Statistic collector, this function runs in a dedicated thread.
+        The function waits on the CAN_STATS_DEV until new data is received, without
+        re-opening the device. In case new data was received, the function will save
+        data in the stats variable.
         In case the data was not reset or read in the last IDPS_DATA_EXPIRATION_INTERVAL,
         the function will reset the statistics, invalidating the entries added in the last
         IDPS_DATA_EXPIRATION_INTERVAL.
         """
-        # Reset data in case it wasn't fetched in the last IDPS data expiration interval
-        if time.time() - self.__last_data_reset > IDPS_DATA_EXPIRATION_INTERVAL:
-            self.__reset_stats()
+        while True:
+            # check if CAN data is available
+            if not os.path.exists(self.CAN_STATS_DEV):
+                self.__ipcf_dev_available = False
+                time.sleep(IDPS_COLLECT_INTERVAL)
+                continue
 
-        # check if CAN data is available
-        if not os.path.exists(self.CAN_STATS_DEV):
-            self.__ipcf_dev_available = False
-        else:
             self.__ipcf_dev_available = True
-            with open(self.CAN_STATS_DEV, "rb") as file_:
-                raw_data = file_.read()
-            if raw_data:
-                self.__update_telemetry_stats(self.__parse_input_data(raw_data))
-
-        threading.Timer(IDPS_COLLECT_INTERVAL, self.__collect_stats).start()
+            try:
+                dev_fd = os.open(self.CAN_STATS_DEV, os.O_RDONLY | os.O_NONBLOCK)
+            except OSError as exception:
+                LOGGER.error("Failed to open %s: %s", self.CAN_STATS_DEV, exception)
+                time.sleep(IDPS_COLLECT_INTERVAL)
+                continue
+
+            poller = select.poll()
+            poller.register(dev_fd, select.POLLIN)
+            try:
+                while True:
+                    # Reset data in case it wasn't fetched in the last IDPS data
+                    # expiration interval
+                    if time.time() - self.__last_data_reset > IDPS_DATA_EXPIRATION_INTERVAL:
+                        self.__reset_stats()
+
+                    if not poller.poll(IDPS_COLLECT_INTERVAL * 1000):
+                        continue
+                    raw_data = self.__read_pending_data(dev_fd)
+                    if raw_data:
+                        self.__update_telemetry_stats(self.__parse_input_data(raw_data))
+            except OSError as exception:
+                LOGGER.error("Failed to read from %s: %s", self.CAN_STATS_DEV, exception)
+            finally:
+                poller.unregister(dev_fd)
+                os.close(dev_fd)
 
 
 # pylint: disable=too-few-public-methods
@@ -0,0 +1,453 @@
+/**
+*   @file       ipc-bench.c
+*   @brief      Echo loopback benchmark of the IPCF channels
+*
+*   Sends messages on a channel echoed by the remote core, via the in-kernel
+*   interface of the driver, and measures the round-trip time of each one,
+*   without the system call and copy costs of the character device. A run is
+*   started by writing "<messages> <size> [<window>]" to
+*   /sys/kernel/debug/ipcfshm/<instance>!<channel>/echo_bench, up to window
+*   messages being in flight, and returns once all the echoes are received.
+*   Reading the file returns the results of the last run, one "<key> <value>"
+*   pair per line, the same keys as the ipcf-bench user space tool.
+*
+*   Each message starts with its sequence number and the run number, in
+*   little-endian byte order, other messages received on the channel are
+*   ignored.
+*/
+/* ==========================================================================
+*   (c) Copyright 2022 NXP
+*   All Rights Reserved.
+=============================================================================*/
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/bitops.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/delay.h>
+#include <linux/sort.h>
+#include <linux/uaccess.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <asm/unaligned.h>
+#include <ipc-chardev-kapi.h>
+#include <ipc-bench.h>
+
+/* ==========================================================================
+ * MACROS AND SYMBOLIC CONSTANTS
+ * ==========================================================================*/
+/* Maximum number of messages of a run */
+#define IPCF_BENCH_MAX_MSGS             (1u << 20)
+
+/* Maximum number of messages in flight */
+#define IPCF_BENCH_MAX_WINDOW           64u
+
+/* Size of the message header, sequence and run numbers */
+#define IPCF_BENCH_HDR_SIZE             (2 * sizeof(__le32))
+
+/* Time to wait for the echo of an in flight message before aborting */
+#define IPCF_BENCH_TIMEOUT              msecs_to_jiffies(1000)
+
+/* Maximum length of a run command */
+#define IPCF_BENCH_CMD_LEN              64u
+
+/* ==========================================================================
+ * STRUCTURES AND TYPEDEFS
+ * ==========================================================================*/
+/* Results of a run */
+struct ipcf_bench_result {
+    /* Error code of the run, 0 if all the messages were echoed */
+    int      status;
+    /* Requested number of messages */
+    uint32_t msgs;
+    /* Message size */
+    uint32_t size;
+    /* Maximum number of messages in flight */
+    uint32_t window;
+    /* Messages sent and echoed */
+    uint32_t sent;
+    uint32_t received;
+    /* Sends retried as no TX buffer was available */
+    uint64_t tx_retries;
+    /* Time from the first send until the last echo */
+    uint64_t duration_ns;
+    /* Round-trip time of the echoed messages */
+    uint64_t rtt_min_ns;
+    uint64_t rtt_mean_ns;
+    uint64_t rtt_p50_ns;
+    uint64_t rtt_p90_ns;
+    uint64_t rtt_p99_ns;
+    uint64_t rtt_p999_ns;
+    uint64_t rtt_max_ns;
+};
+
+/* Benchmark of a channel */
+struct ipcf_bench {
+    /* Serializes the runs, protects the results */
+    struct   mutex lock;
+    /* Subscription to the echoed messages, during a run */
+    struct   ipcf_chdev_subscriber sub;
+    /* Wakes up the run on each echo */
+    wait_queue_head_t wait_q;
+    /* debugfs file driving the benchmark */
+    struct   dentry *file;
+    /* Per message send time, replaced by the round-trip time once echoed */
+    uint64_t *samples;
+    /* Per message flag, set once echoed */
+    unsigned long *echoed;
+    /* Number of messages sent, published once their send time is set */
+    uint32_t sent;
+    /* Number of messages echoed */
+    atomic_t received;
+    /* Run number, tells apart late echoes of a previous run */
+    uint32_t run;
+    /* Set to abort the run */
+    bool     stopping;
+    /* Results of the last run */
+    struct   ipcf_bench_result result;
+    /* Associated instance id */
+    uint8_t  instance_id;
+    /* Associated channel id */
+    uint8_t  channel_id;
+};
+
+/* ==========================================================================
+ *                              LOCAL FUNCTIONS
+ * ==========================================================================*/
+/**
+ *  @brief          Records the round-trip time of an echoed message. Called
+ *                  from the IPCF receive callback.
+ *  @param cb_arg   Pointer to the benchmark
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @param buf      Pointer to the payload
+ *  @param size     Payload size
+ *  @return         N/A
+ */
+static void ipcf_bench_rx_cb(void *cb_arg, uint8_t inst_id, uint8_t chan_id,
+                             const void *buf, size_t size)
+{
+    struct ipcf_bench *bench = cb_arg;
+    u64 now = ktime_get_ns();
+    uint32_t seq;
+
+    if (size < IPCF_BENCH_HDR_SIZE) {
+        return;
+    }
+    seq = get_unaligned_le32(buf);
+    if ((get_unaligned_le32((const uint8_t *)buf + sizeof(__le32)) != bench->run) ||
+        (seq >= smp_load_acquire(&bench->sent)) || test_and_set_bit(seq, bench->echoed)) {
+        return;
+    }
+    bench->samples[seq] = now - bench->samples[seq];
+    atomic_inc(&bench->received);
+    wake_up(&bench->wait_q);
+}
+
+/**
+ *  @brief          Compares two round-trip times, for sort
+ *  @param a        Pointer to the first time
+ *  @param b        Pointer to the second time
+ *  @return         <0, 0, >0 if a is lower, equal or greater than b
+ */
+static int ipcf_bench_cmp_rtt(const void *a, const void *b)
+{
+    u64 rtt_a = *(const u64 *)a;
+    u64 rtt_b = *(const u64 *)b;
+
+    return (rtt_a > rtt_b) - (rtt_a < rtt_b);
+}
+
+/**
+ *  @brief          Computes the round-trip time statistics of a run, from
+ *                  the samples of the echoed messages
+ *  @param bench    Pointer to the benchmark
+ *  @return         N/A
+ */
+static void ipcf_bench_compute(struct ipcf_bench *bench)
+{
+    struct ipcf_bench_result *res = &bench->result;
+    uint32_t count = 0;
+    uint32_t idx;
+    u64 sum = 0;
+
+    /* Keep the round-trip times only, in place */
+    for (idx = 0; idx < res->sent; idx++) {
+        if (test_bit(idx, bench->echoed)) {
+            bench->samples[count++] = bench->samples[idx];
+        }
+    }
+    if (0 == count) {
+        return;
+    }
+    sort(bench->samples, count, sizeof(u64), ipcf_bench_cmp_rtt, NULL);
+    for (idx = 0; idx < count; idx++) {
+        sum += bench->samples[idx];
+    }
+
+    res->rtt_min_ns = bench->samples[0];
+    res->rtt_mean_ns = div_u64(sum, count);
+    res->rtt_p50_ns = bench->samples[div_u64((u64)(count - 1) * 500, 1000)];
+    res->rtt_p90_ns = bench->samples[div_u64((u64)(count - 1) * 900, 1000)];
+    res->rtt_p99_ns = bench->samples[div_u64((u64)(count - 1) * 990, 1000)];
+    res->rtt_p999_ns = bench->samples[div_u64((u64)(count - 1) * 999, 1000)];
+    res->rtt_max_ns = bench->samples[count - 1];
+}
+
+/**
+ *  @brief          Sends the messages of a run and waits for their echoes
+ *  @param bench    Pointer to the benchmark
+ *  @param msg      Message buffer, of the run message size
+ *  @return         0 if all messages were echoed, -ETIMEDOUT if an echo is
+ *                  missing, -EINTR if interrupted or the send error code
+ */
+static int ipcf_bench_exchange(struct ipcf_bench *bench, uint8_t *msg)
+{
+    struct ipcf_bench_result *res = &bench->result;
+    uint32_t seq;
+    long left;
+    int err;
+
+    put_unaligned_le32(bench->run, msg + sizeof(__le32));
+    for (seq = 0; seq < res->msgs; seq++) {
+        left = wait_event_interruptible_timeout(bench->wait_q, READ_ONCE(bench->stopping) ||
+                                                ((seq - atomic_read(&bench->received)) <
+                                                 res->window), IPCF_BENCH_TIMEOUT);
+        if (READ_ONCE(bench->stopping) || (left < 0)) {
+            return -EINTR;
+        }
+        if (0 == left) {
+            return -ETIMEDOUT;
+        }
+
+        put_unaligned_le32(seq, msg);
+        do {
+            bench->samples[seq] = ktime_get_ns();
+            smp_store_release(&bench->sent, seq + 1);
+            err = ipcf_chdev_send(bench->instance_id, bench->channel_id, msg, res->size);
+            if (-EAGAIN == err) {
+                /* Wait for the remote core to free TX buffers */
+                res->tx_retries++;
+                usleep_range(10, 20);
+            }
+        } while ((-EAGAIN == err) && !READ_ONCE(bench->stopping));
+        if (err) {
+            /* The message was not sent */
+            smp_store_release(&bench->sent, seq);
+            return err;
+        }
+        res->sent = seq + 1;
+    }
+
+    left = wait_event_interruptible_timeout(bench->wait_q, READ_ONCE(bench->stopping) ||
+                                            (atomic_read(&bench->received) == res->msgs),
+                                            IPCF_BENCH_TIMEOUT);
+    if (READ_ONCE(bench->stopping) || (left < 0)) {
+        return -EINTR;
+    }
+    return (0 == left) ? -ETIMEDOUT : 0;
+}
+
+/**
+ *  @brief          Runs the benchmark, the results being kept for the
+ *                  debugfs file readers
+ *  @param bench    Pointer to the benchmark
+ *  @param msgs     Number of messages
+ *  @param size     Message size
+ *  @param window   Maximum number of messages in flight
+ *  @return         0 on success, -EINVAL, -ENOMEM, -EBUSY if a run is in
+ *                  progress or the error code of the run
+ */
+static int ipcf_bench_run(struct ipcf_bench *bench, uint32_t msgs, uint32_t size,
+                          uint32_t window)
+{
+    struct ipcf_bench_result *res = &bench->result;
+    uint8_t *msg;
+    uint32_t idx;
+    u64 start;
+    int err;
+
+    if ((0 == msgs) || (msgs > IPCF_BENCH_MAX_MSGS) || (size < IPCF_BENCH_HDR_SIZE) ||
+        (0 == window) || (window > IPCF_BENCH_MAX_WINDOW)) {
+        return -EINVAL;
+    }
+    if (!mutex_trylock(&bench->lock)) {
+        return -EBUSY;
+    }
+
+    memset(res, 0, sizeof(*res));
+    res->msgs = msgs;
+    res->size = size;
+    res->window = window;
+    msg = kmalloc(size, GFP_KERNEL);
+    bench->samples = kvmalloc_array(msgs, sizeof(u64), GFP_KERNEL);
+    bench->echoed = kvcalloc(BITS_TO_LONGS(msgs), sizeof(unsigned long), GFP_KERNEL);
+    if ((NULL == msg) || (NULL == bench->samples) || (NULL == bench->echoed)) {
+        err = -ENOMEM;
+        goto free_bufs;
+    }
+    for (idx = IPCF_BENCH_HDR_SIZE; idx < size; idx++) {
+        msg[idx] = (uint8_t)idx;
+    }
+    bench->sent = 0;
+    atomic_set(&bench->received, 0);
+    bench->run++;
+
+    err = ipcf_chdev_subscribe(bench->instance_id, bench->channel_id, &bench->sub);
+    if (0 == err) {
+        start = ktime_get_ns();
+        err = ipcf_bench_exchange(bench, msg);
+        res->duration_ns = ktime_get_ns() - start;
+        ipcf_chdev_unsubscribe(&bench->sub);
+        res->received = atomic_read(&bench->received);
+        ipcf_bench_compute(bench);
+    }
+    res->status = err;
+
+free_bufs:
+    kvfree(bench->echoed);
+    kvfree(bench->samples);
+    kfree(msg);
+    bench->echoed = NULL;
+    bench->samples = NULL;
+    mutex_unlock(&bench->lock);
+    return err;
+}
+
+/**
+ *  @brief          Shows the results of the last run
+ *  @param s        Sequence file, holding the benchmark
+ *  @param unused   N/A
+ *  @return         0, -EINTR if interrupted while a run is in progress
+ */
+static int ipcf_bench_show(struct seq_file *s, void *unused)
+{
+    struct ipcf_bench *bench = s->private;
+    struct ipcf_bench_result *res = &bench->result;
+    u64 msgs_per_s = 0;
+
+    if (mutex_lock_interruptible(&bench->lock)) {
+        return -EINTR;
+    }
+    if (0 != res->duration_ns) {
+        msgs_per_s = div64_u64((u64)res->received * NSEC_PER_SEC, res->duration_ns);
+    }
+    seq_printf(s, "mode kernel\n");
+    seq_printf(s, "status %d\n", res->status);
+    seq_printf(s, "msgs %u\n", res->msgs);
+    seq_printf(s, "size %u\n", res->size);
+    seq_printf(s, "window %u\n", res->window);
+    seq_printf(s, "sent %u\n", res->sent);
+    seq_printf(s, "received %u\n", res->received);
+    seq_printf(s, "tx_retries %llu\n", res->tx_retries);
+    seq_printf(s, "duration_ns %llu\n", res->duration_ns);
+    seq_printf(s, "msgs_per_s %llu\n", msgs_per_s);
+    seq_printf(s, "bytes_per_s %llu\n", msgs_per_s * res->size);
+    seq_printf(s, "rtt_min_ns %llu\n", res->rtt_min_ns);
+    seq_printf(s, "rtt_mean_ns %llu\n", res->rtt_mean_ns);
+    seq_printf(s, "rtt_p50_ns %llu\n", res->rtt_p50_ns);
+    seq_printf(s, "rtt_p90_ns %llu\n", res->rtt_p90_ns);
+    seq_printf(s, "rtt_p99_ns %llu\n", res->rtt_p99_ns);
+    seq_printf(s, "rtt_p999_ns %llu\n", res->rtt_p999_ns);
+    seq_printf(s, "rtt_max_ns %llu\n", res->rtt_max_ns);
+    mutex_unlock(&bench->lock);
+    return 0;
+}
+
+/**
+ *  @brief          Opens the debugfs file of the benchmark
+ *  @param inode    Inode of the file, holding the benchmark
+ *  @param file     Opened file
+ *  @return         0 on success, -ENOMEM
+ */
+static int ipcf_bench_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, ipcf_bench_show, inode->i_private);
+}
+
+/**
+ *  @brief          Starts a run, "<messages> <size> [<window>]" being written
+ *                  to the debugfs file, and waits for its completion
+ *  @param file     debugfs file
+ *  @param ubuf     User space buffer holding the run command
+ *  @param len      Command length
+ *  @param ppos     File position, unused
+ *  @return         len if the run completed, its error code otherwise
+ */
+static ssize_t ipcf_bench_write(struct file *file, const char __user *ubuf, size_t len,
+                                loff_t *ppos)
+{
+    struct ipcf_bench *bench = ((struct seq_file *)file->private_data)->private;
+    uint32_t msgs;
+    uint32_t size;
+    uint32_t window = 1;
+    char *cmd;
+    int err;
+
+    if (len > IPCF_BENCH_CMD_LEN) {
+        return -EINVAL;
+    }
+    cmd = memdup_user_nul(ubuf, len);
+    if (IS_ERR(cmd)) {
+        return PTR_ERR(cmd);
+    }
+    err = (sscanf(cmd, "%u %u %u", &msgs, &size, &window) < 2) ? -EINVAL : 0;
+    kfree(cmd);
+    if (0 == err) {
+        err = ipcf_bench_run(bench, msgs, size, window);
+    }
+    return err ? err : len;
+}
+
+/* Run command and results of the benchmark */
+static const struct file_operations ipcf_bench_fops = {
+    .owner   = THIS_MODULE,
+    .open    = ipcf_bench_open,
+    .read    = seq_read,
+    .write   = ipcf_bench_write,
+    .llseek  = seq_lseek,
+    .release = single_release,
+};
+
+/* ==========================================================================
+ *                              GLOBAL FUNCTIONS
+ * ==========================================================================*/
+/**
+ *  @brief          Creates the benchmark of a channel, see ipc-bench.h
+ */
+struct ipcf_bench *ipcf_bench_create(struct dentry *dir, uint8_t inst_id, uint8_t chan_id)
+{
+    struct ipcf_bench *bench = kzalloc(sizeof(*bench), GFP_KERNEL);
+
+    if (NULL == bench) {
+        return ERR_PTR(-ENOMEM);
+    }
+    mutex_init(&bench->lock);
+    init_waitqueue_head(&bench->wait_q);
+    bench->instance_id = inst_id;
+    bench->channel_id = chan_id;
+    bench->sub.rx_cb = ipcf_bench_rx_cb;
+    bench->sub.cb_arg = bench;
+    bench->file = debugfs_create_file(IPCF_BENCH_FILE_NAME, 0600, dir, bench,
+                                      &ipcf_bench_fops);
+    return bench;
+}
+
+/**
+ *  @brief          Aborts the running benchmark and frees it, see ipc-bench.h
+ */
+void ipcf_bench_destroy(struct ipcf_bench *bench)
+{
+    if (NULL == bench) {
+        return;
+    }
+    WRITE_ONCE(bench->stopping, true);
+    wake_up(&bench->wait_q);
+    /* Waits for the run in progress, if any */
+    debugfs_remove(bench->file);
+    kfree(bench);
+}
@@ -0,0 +1,38 @@
+/**
+*   @file       ipc-bench.h
+*   @brief      Echo loopback benchmark of the IPCF channels
+*/
+/* ==========================================================================
+*   (c) Copyright 2022 NXP
+*   All Rights Reserved.
+=============================================================================*/
+#ifndef __IPCF_BENCH__H__
+#define __IPCF_BENCH__H__
+
+#include <linux/types.h>
+#include <linux/debugfs.h>
+
+/* Name of the debugfs file driving the benchmark of a channel */
+#define IPCF_BENCH_FILE_NAME            "echo_bench"
+
+struct ipcf_bench;
+
+/**
+ *  @brief          Creates the benchmark of a channel echoed by the remote
+ *                  core, driven by a debugfs file
+ *  @param dir      debugfs directory of the channel
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @return         pointer to the benchmark, ERR_PTR on error
+ */
+struct ipcf_bench *ipcf_bench_create(struct dentry *dir, uint8_t inst_id, uint8_t chan_id);
+
+/**
+ *  @brief          Aborts the running benchmark, if any, and frees it. Shall
+ *                  be called before the debugfs directory is removed.
+ *  @param bench    Pointer to the benchmark, may be NULL
+ *  @return         N/A
+ */
+void ipcf_bench_destroy(struct ipcf_bench *bench);
+
+#endif /* __IPCF_BENCH__H__ */
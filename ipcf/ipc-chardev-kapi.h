@@ -0,0 +1,124 @@
+/**
+*   @file       ipc-chardev-kapi.h
+*   @brief      In-kernel interface of the IPCF character device driver
+*
+*   Other kernel modules can subscribe to the messages received on the IPCF
+*   channels of this driver and send messages on them, next to the character
+*   device users. They shall be built against the Module.symvers of this
+*   module.
+*
+*   The channels are only available once the IPCF link is up: the driver
+*   waits for the remote core of the first instance before initializing
+*   IPCF, so the functions below return -ENODEV until then. The driver
+*   reports the link coming up via a change uevent with IPCF_LINK=up on the
+*   ipcfshm platform device, and via its link_state sysfs attribute. Modules
+*   loaded before should retry later, e.g. from a delayed work, on -ENODEV.
+*/
+/* ==========================================================================
+*   (c) Copyright 2022 NXP
+*   All Rights Reserved.
+=============================================================================*/
+#ifndef __IPCF_CHARDEV_KAPI__H__
+#define __IPCF_CHARDEV_KAPI__H__
+
+#include <linux/types.h>
+#include <linux/list.h>
+
+/**
+ *  @brief          Callback receiving the messages of a channel. Called from
+ *                  the IPCF receive callback, in atomic context: it shall not
+ *                  sleep and shall copy the payload if needed later, the
+ *                  buffer being released on return.
+ *  @param cb_arg   Argument given at subscription
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @param buf      Pointer to the payload
+ *  @param size     Payload size
+ *  @return         N/A
+ */
+typedef void (*ipcf_chdev_rx_cb_t)(void *cb_arg, uint8_t inst_id, uint8_t chan_id,
+                                   const void *buf, size_t size);
+
+/* Subscription to the messages of a channel, owned by the subscriber */
+struct ipcf_chdev_subscriber {
+    /* Callback receiving the messages */
+    ipcf_chdev_rx_cb_t rx_cb;
+    /* Argument of the callback */
+    void *cb_arg;
+    /* Internal, link in the subscribers of the channel */
+    struct list_head node;
+};
+
+/* Statistics of a channel */
+struct ipcf_chdev_stats {
+    /* Received messages accepted in the round buffer */
+    uint64_t rx_msgs;
+    /* Received bytes accepted in the round buffer */
+    uint64_t rx_bytes;
+    /* Transmitted messages */
+    uint64_t tx_msgs;
+    /* Transmitted bytes */
+    uint64_t tx_bytes;
+    /* Pending messages overwritten by newer ones */
+    uint64_t ring_overwrites;
+    /* Received messages dropped because the round buffer was full */
+    uint64_t ring_drops;
+    /* Received messages dropped because they exceed the channel buffers */
+    uint64_t oversize_drops;
+    /* IPCF buffers which could not be acquired for transmission */
+    uint64_t acquire_failures;
+    /* Messages which could not be transmitted */
+    uint64_t tx_errors;
+    /* Current number of pending messages */
+    uint32_t ring_occupancy;
+    /* Maximum number of pending messages */
+    uint32_t ring_high_water;
+};
+
+/**
+ *  @brief          Subscribes to the messages received on a channel. Each
+ *                  message is passed to all subscribers, then queued for the
+ *                  character device readers. May sleep.
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @param sub      Pointer to the subscription, with rx_cb set, which shall
+ *                  stay valid until unsubscribed
+ *  @return         0 on success, -ENODEV if the channel does not exist or
+ *                  the link is not up yet, -EINVAL if no callback is set
+ */
+int ipcf_chdev_subscribe(uint8_t inst_id, uint8_t chan_id, struct ipcf_chdev_subscriber *sub);
+
+/**
+ *  @brief          Cancels a subscription. Once returned, the callback is no
+ *                  longer running nor called. May sleep.
+ *  @param sub      Pointer to the subscription
+ *  @return         N/A
+ */
+void ipcf_chdev_unsubscribe(struct ipcf_chdev_subscriber *sub);
+
+/**
+ *  @brief          Sends a message on a channel. Does not sleep, may be
+ *                  called from atomic context.
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @param buf      Pointer to the payload
+ *  @param size     Payload size, up to the largest buffer size of the channel,
+ *                  or its maximum message size if it uses fragmentation
+ *  @return         0 on success, -ENODEV if the channel does not exist or
+ *                  the link is not up yet, -EMSGSIZE if the payload is too large, -EAGAIN if no TX
+ *                  buffer is available or another fragmented message is
+ *                  being sent, or the IPCF error code
+ */
+int ipcf_chdev_send(uint8_t inst_id, uint8_t chan_id, const void *buf, size_t size);
+
+/**
+ *  @brief          Gets the statistics of a channel
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @param stats    Pointer to the returned statistics
+ *  @return         0 on success, -ENODEV if the channel does not exist or
+ *                  the link is not up yet
+ */
+int ipcf_chdev_get_stats(uint8_t inst_id, uint8_t chan_id, struct ipcf_chdev_stats *stats);
+
+#endif /* __IPCF_CHARDEV_KAPI__H__ */
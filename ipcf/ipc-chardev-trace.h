@@ -0,0 +1,125 @@
+/**
+*   @file       ipc-chardev-trace.h
+*   @brief      Tracepoints of the IPCF character device driver
+*
+*   The events are available under /sys/kernel/tracing/events/ipcf.
+*/
+/* ==========================================================================
+*   (c) Copyright 2022 NXP
+*   All Rights Reserved.
+=============================================================================*/
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ipcf
+
+#if !defined(__IPCF_CHARDEV_TRACE__H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __IPCF_CHARDEV_TRACE__H__
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+/* Message passing through the round buffer of a channel, idx being the free
+   running ring index of the message */
+DECLARE_EVENT_CLASS(ipcf_ring_msg,
+
+    TP_PROTO(uint8_t inst_id, uint8_t chan_id, uint32_t size, uint32_t idx),
+
+    TP_ARGS(inst_id, chan_id, size, idx),
+
+    TP_STRUCT__entry(
+        __field(uint8_t, inst_id)
+        __field(uint8_t, chan_id)
+        __field(uint32_t, size)
+        __field(uint32_t, idx)
+    ),
+
+    TP_fast_assign(
+        __entry->inst_id = inst_id;
+        __entry->chan_id = chan_id;
+        __entry->size = size;
+        __entry->idx = idx;
+    ),
+
+    TP_printk("instance=%u channel=%u size=%u idx=%u",
+              __entry->inst_id, __entry->chan_id, __entry->size, __entry->idx)
+);
+
+/* Message received from IPCF, idx being the producer index on arrival */
+DEFINE_EVENT(ipcf_ring_msg, ipcf_rx_cb,
+    TP_PROTO(uint8_t inst_id, uint8_t chan_id, uint32_t size, uint32_t idx),
+    TP_ARGS(inst_id, chan_id, size, idx)
+);
+
+/* Message copied to user space by a read call */
+DEFINE_EVENT(ipcf_ring_msg, ipcf_read,
+    TP_PROTO(uint8_t inst_id, uint8_t chan_id, uint32_t size, uint32_t idx),
+    TP_ARGS(inst_id, chan_id, size, idx)
+);
+
+/* Message about to be sent */
+DECLARE_EVENT_CLASS(ipcf_tx_msg,
+
+    TP_PROTO(uint8_t inst_id, uint8_t chan_id, uint32_t size),
+
+    TP_ARGS(inst_id, chan_id, size),
+
+    TP_STRUCT__entry(
+        __field(uint8_t, inst_id)
+        __field(uint8_t, chan_id)
+        __field(uint32_t, size)
+    ),
+
+    TP_fast_assign(
+        __entry->inst_id = inst_id;
+        __entry->chan_id = chan_id;
+        __entry->size = size;
+    ),
+
+    TP_printk("instance=%u channel=%u size=%u",
+              __entry->inst_id, __entry->chan_id, __entry->size)
+);
+
+/* write call, size being the number of bytes to send */
+DEFINE_EVENT(ipcf_tx_msg, ipcf_write,
+    TP_PROTO(uint8_t inst_id, uint8_t chan_id, uint32_t size),
+    TP_ARGS(inst_id, chan_id, size)
+);
+
+/* IPCF buffer handed over to ipc_shm_tx */
+DEFINE_EVENT(ipcf_tx_msg, ipcf_tx_start,
+    TP_PROTO(uint8_t inst_id, uint8_t chan_id, uint32_t size),
+    TP_ARGS(inst_id, chan_id, size)
+);
+
+/* ipc_shm_tx completed, with its error code */
+TRACE_EVENT(ipcf_tx_end,
+
+    TP_PROTO(uint8_t inst_id, uint8_t chan_id, uint32_t size, int err),
+
+    TP_ARGS(inst_id, chan_id, size, err),
+
+    TP_STRUCT__entry(
+        __field(uint8_t, inst_id)
+        __field(uint8_t, chan_id)
+        __field(uint32_t, size)
+        __field(int, err)
+    ),
+
+    TP_fast_assign(
+        __entry->inst_id = inst_id;
+        __entry->chan_id = chan_id;
+        __entry->size = size;
+        __entry->err = err;
+    ),
+
+    TP_printk("instance=%u channel=%u size=%u err=%d",
+              __entry->inst_id, __entry->chan_id, __entry->size, __entry->err)
+);
+
+#endif /* __IPCF_CHARDEV_TRACE__H__ */
+
+/* This part must be outside the header guard */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE ipc-chardev-trace
+#include <trace/define_trace.h>
@@ -21,12 +21,47 @@
 #include <linux/device.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
+#include <linux/of_irq.h>
+#include <linux/interrupt.h>
+#include <linux/cpumask.h>
+#include <linux/platform_device.h>
 #include <linux/kern_levels.h>
 #include <linux/ioport.h>
 #include <linux/mod_devicetable.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/cache.h>
+#include <linux/mutex.h>
+#include <linux/capability.h>
+#include <linux/spinlock.h>
+#include <linux/atomic.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/moduleparam.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uio.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <linux/list.h>
+#include <linux/rculist.h>
+#include <linux/hrtimer.h>
+#include <linux/sort.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 #include <ipc-shm.h>
 #include <ipc-mem-cfg.h>
+#include <ipc-chardev.h>
+#include <ipc-chardev-kapi.h>
+#include <ipc-netdev.h>
+#include <ipc-bench.h>
+
+#define CREATE_TRACE_POINTS
+#include "ipc-chardev-trace.h"
 
 /* ==========================================================================
  * MODULE INFORMATION
@@ -48,59 +83,509 @@ MODULE_VERSION(MODULE_VER);
 /* Marker for IPCF instances / channels */
 #define IPC_INVALID                     0xFFu
 
-/* IPCF instances count, by default, only one is enabled */
+/* IPCF instances count, by default, only one is enabled. Instance n uses M7
+ * core n as remote core and the n-th nxp,s32g-ipcf-shm device tree node as
+ * shared memory. Only the instances with a device tree node and a running
+ * M7 core are initialized, up to the first missing one */
 #ifndef IPC_NUM_INSTANCES
 #define IPC_NUM_INSTANCES               1u
 #endif /* IPC_NUM_INSTANCES */
 
+#if (IPC_NUM_INSTANCES > IPC_NUM_M7_CORES)
+#error "IPC_NUM_INSTANCES exceeds the number of M7 cores of the platform"
+#endif
+
 #ifndef IPC_INST_0_CHAN_NUM
 #define IPC_INST_0_CHAN_NUM             2u
 #endif /* IPC_INST_0_CHAN_NUM */
 
+/* The other instances have generic data channels, one by default */
 #ifndef IPC_INST_1_CHAN_NUM
+#if (IPC_NUM_INSTANCES > 1)
+#define IPC_INST_1_CHAN_NUM             1u
+#else
 #define IPC_INST_1_CHAN_NUM             0u
+#endif
 #endif /* IPC_INST_1_CHAN_NUM */
 
 #ifndef IPC_INST_2_CHAN_NUM
+#if (IPC_NUM_INSTANCES > 2)
+#define IPC_INST_2_CHAN_NUM             1u
+#else
 #define IPC_INST_2_CHAN_NUM             0u
+#endif
 #endif /* IPC_INST_2_CHAN_NUM */
 
 #ifndef IPC_INST_3_CHAN_NUM
+#if (IPC_NUM_INSTANCES > 3)
+#define IPC_INST_3_CHAN_NUM             1u
+#else
 #define IPC_INST_3_CHAN_NUM             0u
+#endif
 #endif /* IPC_INST_3_CHAN_NUM */
 
 /* Total number of IPCF channels */
 #define IPC_NUM_CHANNELS                (IPC_INST_0_CHAN_NUM + IPC_INST_1_CHAN_NUM +\
                                          IPC_INST_2_CHAN_NUM + IPC_INST_3_CHAN_NUM)
 
+/* Size of the message size prepended to data read from user space */
+#define IPC_MSG_SIZE_LEN                sizeof(uint32_t)
+
 /* Maximum name size for a channel/instance */
 #define MAX_NAME_SIZE                   20u
 
-/* A53 RX interupt number */
-#define INTER_CORE_RX_IRQ               2u
+/* Maximum number of slots of a round buffer */
+#define IPC_MAX_QUEUE_SIZE              4096u
+
+/* Offset of the first slot in the round buffer */
+#define IPC_RING_SLOTS_OFFSET           ALIGN(sizeof(struct ipcf_rx_ring_hdr), \
+                                              IPCF_RX_RING_LINE_SIZE)
+
+/* Number of buckets of the RX latency histogram, bucket i counting the
+   latencies in [2^i, 2^(i+1)) ns, the last one all the longer ones */
+#define IPC_LAT_HIST_BUCKETS            40u
+
+/* Number of acquired IPCF TX buffers which can be kept per channel for
+   later writes, e.g. after a failed send */
+#define IPC_TX_SPARE_BUFS               4u
+
+/* Interval between two attempts to acquire a TX buffer once the local
+   pools of a channel are exhausted */
+#define IPC_TX_RETRY_INTERVAL           msecs_to_jiffies(1)
+
+/* Default time a blocking write waits for a TX buffer, in ms */
+#define IPC_TX_TIMEOUT_MS               1000u
+
+/* Maximum number of messages handled by one poll of an instance in polled
+   RX mode, the remaining ones being handled by the next poll */
+#define IPC_RX_POLL_BUDGET              256u
+
+/* Maximum factor applied to the poll period of an idle instance, in polled
+   RX mode */
+#define IPC_RX_POLL_MAX_BACKOFF         8u
+
+/* First and maximum interval between two checks of the M7 core status while
+   waiting for the remote core to start, or between two attempts to bring the
+   link up after a failure, in ms */
+#define IPC_LINK_RETRY_MIN_MS           10u
+#define IPC_LINK_RETRY_MAX_MS           1000u
+
+/* Interval between two checks of the M7 core status once the link is up,
+   in ms */
+#define IPC_LINK_MONITOR_MS             1000u
+
+/* RX CPU affinity policies of an instance, other values being the CPU on
+   which the RX interrupt and the poll timer are pinned */
+#define IPC_RX_CPU_ANY                  (-1)
+#define IPC_RX_CPU_READER               (-2)
+
+/* Number of A53 cores to which the inter-core interrupts can be routed, the
+   trusted local cores */
+#define IPC_NUM_RX_CORES                4
+
+/* Upper bounds of the ipc-shm layout of a channel in each shared memory area,
+   used to report an undersized area before initializing IPCF: control words
+   of a queue, size of a descriptor in the channel queue and size of a buffer
+   index in a pool queue, each queue holding two rings */
+#define IPC_SHM_QUEUE_HDR_SIZE          64u
+#define IPC_SHM_BD_SIZE                 8u
+#define IPC_SHM_BUF_IDX_SIZE            2u
+
+/* Priority byte offset of the channels whose remote core does not set one */
+#define IPC_PRIO_OFFSET_NONE            (-1)
+
+/* Largest message of the channels using fragmentation */
+#define IPC_FRAG_MAX_MSG_SIZE           (1u << 20)
+
+/* Number of entries of the fragmentation store of a channel, keeping the
+   reassembled messages larger than a round buffer slot until read, power of
+   two */
+#define IPC_FRAG_STORE_MSGS             4u
+
+/* Time after which a message whose reassembly started is discarded, its
+   missing fragments being considered lost, in ns */
+#define IPC_FRAG_TIMEOUT_NS             (100u * NSEC_PER_MSEC)
 
 /* ==========================================================================
  * STRUCTURES AND TYPEDEFS
  * ==========================================================================*/
-/* IPCF channel descriptor, internal structure of the character device driver */
+/* Policy applied by the receive callback when the round buffer is full */
+enum ipc_overflow_policy_t {
+    /* Overwrite the oldest message */
+    IPC_OVERFLOW_OVERWRITE = 0,
+    /* Drop the received message */
+    IPC_OVERFLOW_DROP,
+    /* Hold the IPCF buffer until the readers free a slot, the remote core
+       is throttled once its pool is exhausted */
+    IPC_OVERFLOW_LOSSLESS,
+};
+
+/* Metadata of a received message, stored in its slot header and reported
+   in the extended frame header */
+struct ipc_rx_meta_t {
+    /* Arrival time of the message, in ns */
+    u64      stamp;
+    /* Sequence number of the message, counting all received messages */
+    uint32_t seq;
+    /* Frame flags, IPCF_FRAME_F_* */
+    uint16_t flags;
+};
+
+/* IPCF buffer held by the receive callback on lossless channels */
+struct ipc_held_buf_t {
+    /* Received IPCF buffer */
+    void     *buf;
+    /* Message size */
+    uint32_t size;
+    /* Message metadata */
+    struct   ipc_rx_meta_t meta;
+};
+
+/* Acquired IPCF TX buffer kept for a later write */
+struct ipc_tx_buf_t {
+    /* IPCF buffer, NULL if none */
+    void     *buf;
+    /* Minimum buffer size */
+    uint32_t size;
+};
+
+/* IPCF channel statistics, exposed via sysfs under the statistics group of
+ * each device */
+struct ipc_chan_stats_t {
+    /* Counters updated by the producer of the round buffer only, the receive
+       callback or the readers holding the producer lock */
+    /* Received messages accepted in the round buffer */
+    uint64_t rx_msgs;
+    /* Received bytes accepted in the round buffer */
+    uint64_t rx_bytes;
+    /* Pending messages overwritten by newer ones */
+    uint64_t ring_overwrites;
+    /* Received messages dropped because the round buffer was full */
+    uint64_t ring_drops;
+    /* Received messages dropped because they exceed the channel buffers */
+    uint64_t oversize_drops;
+    /* Maximum number of pending messages */
+    uint32_t ring_high_water;
+    /* Fragments received on channels using fragmentation */
+    uint64_t rx_frags;
+    /* Messages discarded as one of their fragments was missing */
+    uint64_t rx_frag_incomplete;
+    /* Messages discarded as their fragments were not received in time */
+    uint64_t rx_frag_timeouts;
+    /* Fragments dropped as not belonging to the message being reassembled */
+    uint64_t rx_frag_errors;
+    /* Counters updated by the readers and writers, on other cache lines */
+    /* Transmitted messages */
+    atomic64_t tx_msgs ____cacheline_aligned_in_smp;
+    /* Transmitted bytes */
+    atomic64_t tx_bytes;
+    /* IPCF buffers which could not be acquired for transmission */
+    atomic64_t acquire_failures;
+    /* Messages which could not be transmitted */
+    atomic64_t tx_errors;
+    /* Writers which had to wait for a TX buffer */
+    atomic64_t tx_waits;
+    /* Writers which timed out waiting for a TX buffer */
+    atomic64_t tx_timeouts;
+    /* Messages which could not be copied from user space */
+    atomic64_t tx_copy_faults;
+    /* TX buffers lost after a failed send, no spare slot being free */
+    atomic64_t tx_buf_leaks;
+    /* Fragments transmitted on channels using fragmentation */
+    atomic64_t tx_frags;
+    /* Messages aborted after some of their fragments were transmitted */
+    atomic64_t tx_frag_aborts;
+    /* read system calls */
+    atomic64_t read_calls;
+    /* write system calls */
+    atomic64_t write_calls;
+    /* Messages consumed by a reader without being copied, filtered out */
+    atomic64_t rx_filtered;
+    /* log2 histogram of the time from the receive callback until the
+       message is consumed by user space */
+    atomic64_t rx_latency[IPC_LAT_HIST_BUCKETS];
+};
+
+/* Message claimed from the round buffer of a channel by a reader */
+struct ipc_ring_msg_t {
+    /* Lane holding the message */
+    struct   ipc_lane_t *lane;
+    /* Slot holding the message */
+    struct   ipcf_rx_slot_hdr *slot;
+    /* Free running index of the message */
+    uint32_t idx;
+    /* Payload size */
+    uint32_t size;
+    /* IPCF buffer holding the payload, on deferred release channels */
+    void     *buf;
+    /* Fragmentation store entry holding the payload, NULL if held by the
+       slot, and index of the message in the store */
+    struct   ipcf_rx_slot_hdr *store;
+    uint32_t store_seq;
+    /* Message metadata */
+    struct   ipc_rx_meta_t meta;
+};
+
+/* IDPS aggregator of a channel */
+struct ipc_idps_aggr_t {
+    /* Serializes the receive callback and the readers of the counters */
+    spinlock_t lock;
+    /* Counters, the message id table being unsorted */
+    struct   ipcf_idps_stats stats;
+};
+
+/* Priority lane of a channel, a round buffer of its own within the channel
+ * mapping, see PRIORITY LANES in ipc-chardev.h. Channels without priority
+ * lanes only use lane 0 */
+struct ipc_lane_t {
+    /* Round buffer of the lane, see ipc-chardev.h for the layout. The
+       producer and consumer indices of the ring header keep track of the
+       pending messages (messages received via callback but not yet read).
+       The producer index is only written by the receive callback, the
+       consumer index only by the readers, each one on its own cache line,
+       hence the ring needs no lock on the receive path. */
+    struct   ipcf_rx_ring_hdr *ring;
+    /* Offset of the round buffer in the channel mapping */
+    uint32_t ring_offset;
+    /* Number of slots of the round buffer, power of two */
+    uint32_t queue_depth;
+    /* Policy applied when the round buffer is full */
+    enum     ipc_overflow_policy_t overflow_policy;
+    /* Round queue of the IPCF buffers held on lossless lanes, sized to the
+       number of IPCF buffers of the channel */
+    struct   ipc_held_buf_t *held;
+    uint32_t held_size;
+    /* Lane index */
+    uint8_t  id;
+};
+
+/* Lane filters of a channel, freed once no receive callback evaluates them */
+struct ipc_lane_filters_t {
+    struct rcu_head rcu;
+    /* Filter of each lane, lane 0 being the default one */
+    struct ipcf_filter lanes[IPCF_RX_MAX_LANES];
+};
+
+/* Message referenced by an entry of the fragmentation store, only accessed
+ * by the receive callback */
+struct ipc_frag_store_ref_t {
+    /* Lane of the message, NULL if the entry was never used */
+    struct   ipc_lane_t *lane;
+    /* Free running index of the message in the lane */
+    uint32_t idx;
+};
+
+/* Reassembly state of a channel using fragmentation, only accessed by the
+ * receive callback */
+struct ipc_frag_rx_t {
+    /* A message is being reassembled */
+    bool     in_progress;
+    /* Sequence number of the message being reassembled */
+    uint16_t msg_seq;
+    /* Size of the message, and of its fragments received so far */
+    uint32_t msg_size;
+    uint32_t received;
+    /* Reception time of the first fragment, in ns */
+    u64      stamp;
+    /* Reassembly buffer, of the maximum message size of the channel */
+    uint8_t  buf[];
+};
+
+/* IPCF channel descriptor, internal structure of the character device driver.
+ * Each descriptor is allocated on its own, the fields being grouped by writer
+ * on separate cache lines: the configuration, read-mostly, the receive path
+ * running on the RX interrupt CPU, the readers and the writers, so that the
+ * CPUs do not false-share the descriptor while messages flow. */
 struct ipc_chan_descr_t {
-    /* Memory pool, handled as a round buffer */
-    uint8_t  chan_pool[IPC_QUEUE_SIZE][IPCF_BUF_LEN];
-    /* Array of message sizes received from the remote counterpart */
-    uint32_t msg_size[IPC_QUEUE_SIZE];
-    /* Message status */
-    bool     msg_processed[IPC_QUEUE_SIZE];
-    /* Associated character device driver */
-    struct   cdev chardev;
-    /* Index of the next free buffer in the round memory pool */
-    uint32_t free_buff_idx;
-    /* Number of pending messages (messages received via callback)
-       but not read via the ipcf_read function */
-    uint32_t num_pending_msg;
+    /* Memory pool, handled as one round buffer per priority lane, which can
+       be mapped in user space, lane 0 first */
+    struct   ipc_lane_t lanes[IPCF_RX_MAX_LANES];
+    /* Number of priority lanes, 1 if the channel has none */
+    uint8_t  num_lanes;
+    /* Payload offset of the priority byte selecting the lane of a received
+       message, IPC_PRIO_OFFSET_NONE if not used */
+    int16_t  prio_offset;
+    /* Lane filters, NULL if none was installed, RCU protected */
+    struct   ipc_lane_filters_t __rcu *lane_filters;
+    /* Memory size of the round buffers, as mapped in user space */
+    size_t   ring_size;
+    /* Size of a round buffer slot, slot header and payload, in whole cache
+       lines */
+    uint32_t slot_size;
+    /* Maximum message size, the buffer size of the largest IPCF pool unless
+       the channel uses fragmentation */
+    uint32_t max_msg_size;
+    /* Buffer size of the largest IPCF pool */
+    uint32_t max_buf_size;
+    /* Minimum message size, the buffer size of the smallest IPCF pool */
+    uint32_t min_msg_size;
+    /* The round buffer only references the IPCF buffers, which are released
+       once consumed */
+    bool     deferred_release;
+    /* Each reader gets all the messages, tracking its own read cursor */
+    bool     fan_out;
+    /* The instance is polled, readers are woken once per poll */
+    bool     rx_polled;
     /* Associated instance id */
     uint8_t  instance_id;
     /* Associated channel id */
     uint8_t  channel_id;
+    /* IPCF buffers referenced by each slot, on deferred release channels */
+    void     **rx_refs;
+    /* IDPS aggregator, NULL if not enabled */
+    struct   ipc_idps_aggr_t *idps;
+    /* Reassembly state, NULL if the channel does not use fragmentation */
+    struct   ipc_frag_rx_t *frag_rx;
+    /* Fragmentation store, in the channel mapping after the lanes, holding
+       the reassembled messages larger than a slot. NULL if not used */
+    uint8_t  *frag_store;
+    /* Offset of the store in the channel mapping */
+    uint32_t frag_store_offset;
+    /* Size of a store entry, slot header and payload, in whole cache lines */
+    uint32_t frag_entry_size;
+    /* Index of the next message written to the store */
+    uint32_t frag_store_head;
+    /* Message referencing each store entry */
+    struct   ipc_frag_store_ref_t frag_store_refs[IPC_FRAG_STORE_MSGS];
+    /* Kernel subscribers, struct ipcf_chdev_subscriber, RCU protected */
+    struct   list_head subscribers;
+    /* Network device front end, NULL if not enabled */
+    struct   net_device *netdev;
+    /* Echo loopback benchmark, NULL if not enabled */
+    struct   ipcf_bench *bench;
+    /* Associated character device driver */
+    struct   cdev chardev;
+
+    /* Receive path, the receive callback being the single producer */
+    /* Sequence number of the next received message */
+    uint32_t rx_seq ____cacheline_aligned_in_smp;
+    /* Frame flags of the messages lost since the last one accepted in the
+       round buffer, reported with the next accepted one */
+    uint16_t rx_lost_flags;
+    /* Messages were received since the last poll woke the readers */
+    bool     rx_wake_pending;
+    /* Free running indices of the held IPCF buffers of each lane */
+    uint32_t held_head[IPCF_RX_MAX_LANES];
+    uint32_t held_tail[IPCF_RX_MAX_LANES];
+    /* Serializes the producers of lossless lanes, the receive callback
+       and the readers moving held buffers to the round buffer */
+    spinlock_t producer_lock;
+    /* Channel statistics, the counters of the receive path first */
+    struct   ipc_chan_stats_t stats;
+
+    /* Readers */
+    /* Serializes the readers of the channels allowing multiple consumers,
+       never taken by the receive callback */
+    spinlock_t consumer_lock ____cacheline_aligned_in_smp;
+    /* Number of files open for reading on single consumer channels */
+    atomic_t num_readers;
+    /* Wait queue for readers blocked on an empty pool, woken by the
+       receive callback */
+    wait_queue_head_t rx_wait_q;
+
+    /* Writers */
+    /* Address at which IPCF maps the first buffer of the pool the TX window
+       buffers are acquired from, NULL until a buffer of the window was
+       acquired */
+    uint8_t  *tx_window_pool ____cacheline_aligned_in_smp;
+    /* Size of the TX window pool */
+    uint32_t tx_window_pool_size;
+    /* Offset of the TX window pool in the TX window mapping */
+    uint32_t tx_window_pool_offset;
+    /* Page aligned physical address and size of the TX window mapping, 0 if
+       the channel has no TX window */
+    phys_addr_t tx_window_phys;
+    uint32_t tx_window_map_size;
+    /* TX window buffers left by the closed files, protected by tx_lock.
+       NULL for free slots */
+    void     *tx_window_free[IPCF_TX_WINDOW_MAX_BUFS];
+    /* TX buffers acquired but not sent, used first by the next writes */
+    struct   ipc_tx_buf_t tx_spare[IPC_TX_SPARE_BUFS];
+    /* Protects the spare TX buffers, also used by the kernel senders */
+    spinlock_t tx_lock;
+    /* Wait queue for writers blocked on exhausted pools, woken
+       periodically by tx_retry_work while some are waiting */
+    wait_queue_head_t tx_wait_q;
+    /* Wakes the TX waiters to try acquiring a buffer again */
+    struct   delayed_work tx_retry_work;
+    /* The last attempt to acquire a TX buffer failed, cleared by
+       tx_retry_work. Lets poll report the channel writable without
+       acquiring a buffer itself */
+    bool     tx_exhausted;
+    /* Bit 0 is set while a fragmented message is being transmitted, so
+       that the fragments of two messages are not interleaved */
+    unsigned long tx_frag_busy;
+    /* Sequence number of the next fragmented message */
+    uint16_t tx_frag_seq;
+};
+
+/* Polled RX state of an IPCF instance */
+struct ipc_inst_poll_t {
+    /* Timer polling the channels of the instance */
+    struct   hrtimer timer;
+    /* Poll period while messages are received */
+    ktime_t  period;
+    /* Factor applied to the poll period, doubled on each poll finding no
+       message up to IPC_RX_POLL_MAX_BACKOFF, reset by a received message */
+    uint32_t backoff;
+    /* Number of polls */
+    atomic64_t polls;
+    /* Number of messages received via polling */
+    atomic64_t msgs;
+    /* RX interrupt of the instance configuration, disabled while polling
+       and restored once IPCF is freed */
+    int      rx_irq;
+    /* Associated instance id */
+    uint8_t  instance_id;
+};
+
+/* RX CPU affinity state of an IPCF instance */
+struct ipc_inst_affinity_t {
+    /* Affinity policy, IPC_RX_CPU_ANY, IPC_RX_CPU_READER or a CPU number */
+    int      policy;
+    /* CPU currently handling the RX path, -1 if not steered. Only set by
+       the affinity work once the RX path was moved */
+    int      cpu;
+    /* CPU the RX path shall be moved to, -1 if none */
+    int      target;
+    /* Linux RX interrupt of the instance, from its device tree node, not
+       positive if not described there */
+    int      irq;
+    /* Moves the RX interrupt and the poll timer to target, running on it */
+    struct   work_struct work;
+    /* Set at module exit, the RX path is no longer moved */
+    bool     stopping;
+};
+
+/* State of an open device file */
+struct ipc_file_t {
+    /* Associated channel */
+    struct   ipc_chan_descr_t *ch;
+    /* Free running index of the next message to be read, on fan-out
+       channels, where each file has its own read cursor */
+    uint32_t cursor;
+    /* Messages overwritten before being read via this file */
+    uint64_t overruns;
+    /* Serializes the readers of the file, from claiming messages to
+       releasing them, and the consumers of mapped messages: the read cursor
+       of the file, or the consumer index of single consumer channels, only
+       moves under this lock */
+    struct   mutex read_lock;
+    /* Message filter of the reader, NULL if all messages are read */
+    struct   ipc_file_filter_t __rcu *filter;
+    /* Serializes the filter updates */
+    struct   mutex filter_lock;
+    /* IPCF buffers of the TX window acquired via this file, filled in place
+       via the TX window mapping. NULL for indices without an acquired buffer */
+    void     *tx_window[IPCF_TX_WINDOW_MAX_BUFS];
+    /* Serializes the TX window operations of the file */
+    struct   mutex tx_window_lock;
+};
+
+/* Message filter of an open file, freed once no reader evaluates it */
+struct ipc_file_filter_t {
+    struct rcu_head rcu;
+    struct ipcf_filter rules;
 };
 
 /* IPCF instance descriptor used to map the existing channels in the rootfs.
@@ -116,6 +601,82 @@ struct ipc_inst_descr_t {
     /* Array of configuration structures which enforce data size
        prepending to data read from user space */
     bool chan_prepend_size[IPC_SHM_MAX_CHANNELS];
+    /* Array of configuration structures which allow a single read to return
+       as many complete messages as fit in the user buffer. Only used for the
+       channels which have data size prepending enabled, as the size is
+       needed to delimit the messages */
+    bool chan_batch_read[IPC_SHM_MAX_CHANNELS];
+    /* Array of configuration structures which enforce an extended frame
+       header, struct ipcf_frame_hdr, prepended to data read from user space
+       instead of the data size. The header carries the data size as well,
+       hence allows batched reads */
+    bool chan_frame_hdr[IPC_SHM_MAX_CHANNELS];
+    /* Number of IPCF buffers held in the TX window of each channel, up to
+       IPCF_TX_WINDOW_MAX_BUFS. 0 disables the TX window */
+    uint8_t chan_tx_window_bufs[IPC_SHM_MAX_CHANNELS];
+    /* Maximum message size of the channels carrying messages larger than the
+       IPCF buffers, sent as fragments preceded by struct ipcf_frag_hdr, see
+       ipc-chardev.h, up to IPC_FRAG_MAX_MSG_SIZE. 0 disables fragmentation */
+    uint32_t chan_frag_max_size[IPC_SHM_MAX_CHANNELS];
+    /* Array of configuration structures which allow multiple readers on a
+       channel, serialized via a spinlock. Otherwise, a channel can only be
+       open for reading once, the reader being the single ring consumer */
+    bool chan_multi_consumer[IPC_SHM_MAX_CHANNELS];
+    /* Default number of slots of the round buffer of each channel,
+       rounded up to a power of two */
+    uint32_t chan_queue_depth[IPC_SHM_MAX_CHANNELS];
+    /* Default policy applied when the round buffer of a channel is full */
+    enum ipc_overflow_policy_t chan_overflow_policy[IPC_SHM_MAX_CHANNELS];
+    /* Number of priority lanes of each channel, up to IPCF_RX_MAX_LANES, 0
+       or 1 for channels without priority lanes. The lanes of a channel use
+       their own depth and policy below instead of the channel ones */
+    uint8_t chan_num_lanes[IPC_SHM_MAX_CHANNELS];
+    /* Default number of slots of each priority lane, 0 for the channel
+       depth */
+    uint32_t chan_lane_depth[IPC_SHM_MAX_CHANNELS][IPCF_RX_MAX_LANES];
+    /* Default policy applied when each priority lane is full */
+    enum ipc_overflow_policy_t chan_lane_policy[IPC_SHM_MAX_CHANNELS][IPCF_RX_MAX_LANES];
+    /* Payload offset of the priority byte set by the remote core, selecting
+       the priority lane of each message, IPC_PRIO_OFFSET_NONE if not set */
+    int16_t chan_prio_offset[IPC_SHM_MAX_CHANNELS];
+    /* Array of configuration structures which enforce the deferred release
+       of the received IPCF buffers: messages are not copied to the round
+       buffer, their IPCF buffer is held until consumed by the readers. The
+       round buffer depth and overflow policy are then given by the IPCF
+       pools, which throttle the remote core once exhausted */
+    bool chan_deferred_release[IPC_SHM_MAX_CHANNELS];
+    /* Array of configuration structures which enforce the fan-out of the
+       received messages: any number of readers can open the channel, each
+       of them reading all the messages received after it opened the
+       channel, at its own pace. Messages are still copied once to the round
+       buffer, which always overwrites the oldest message, the readers
+       lagging behind more than a full round buffer losing messages */
+    bool chan_fan_out[IPC_SHM_MAX_CHANNELS];
+    /* Array of configuration structures which expose the channel as a
+       network device as well, see ipc-netdev.c. The messages are passed to
+       the network stack next to the character device readers */
+    bool chan_netdev[IPC_SHM_MAX_CHANNELS];
+    /* Array of configuration structures which decode the received messages
+       as IDPS records and aggregate them into counters, returned via
+       IPCF_IOC_IDPS_STATS, see ipc-chardev.h */
+    bool chan_idps_aggr[IPC_SHM_MAX_CHANNELS];
+    /* Array of configuration structures which provide the echo loopback
+       benchmark on the channels echoed by the remote core, via debugfs,
+       see ipc-bench.c */
+    bool chan_echo_bench[IPC_SHM_MAX_CHANNELS];
+    /* Period of the polled RX mode, in us. The RX interrupt of the instance
+       is then not used, its channels being drained from a timer, in
+       batches of up to IPC_RX_POLL_BUDGET messages, which bounds the added
+       latency to IPC_RX_POLL_MAX_BACKOFF periods. Both modes are exclusive
+       while IPCF is initialized, IPCF only taking its RX interrupt at init.
+       0 keeps one interrupt per message */
+    uint32_t rx_poll_period_us;
+    /* RX CPU affinity policy: IPC_RX_CPU_ANY leaves the placement to the
+       kernel, a CPU number pins the RX interrupt, thus the receive callback
+       copying the messages to the round buffers, and the poll timer of the
+       polled RX mode to this CPU. IPC_RX_CPU_READER moves them to the CPU
+       of the last reader of the instance */
+    int rx_cpu;
     /* Number of channels assigned to the instance */
     uint8_t channel_count;
 };
@@ -125,16 +686,61 @@ struct ipc_inst_descr_t {
  * ==========================================================================*/
 int ipcf_close(struct inode *pinode, struct file *pfile);
 int ipcf_open(struct inode *pinode, struct file *pfile);
-ssize_t ipcf_read(struct file *pfile, char __user *buffer, size_t length,
-                  loff_t *offset);
-ssize_t ipcf_write(struct file *pfile, const char __user *buffer, size_t length,
-                   loff_t *offset);
+__poll_t ipcf_poll(struct file *pfile, struct poll_table_struct *wait);
+int ipcf_mmap(struct file *pfile, struct vm_area_struct *vma);
+long ipcf_ioctl(struct file *pfile, unsigned int cmd, unsigned long arg);
+ssize_t ipcf_read_iter(struct kiocb *iocb, struct iov_iter *to);
+ssize_t ipcf_write_iter(struct kiocb *iocb, struct iov_iter *from);
 static void init_state_vars(void);
+static int alloc_chan_rings(void);
+static uint32_t get_chan_max_buf_size(uint8_t inst_id, uint8_t chan_id);
+static uint32_t get_chan_num_bufs(uint8_t inst_id, uint8_t chan_id);
+static uint32_t get_inst_shm_footprint(uint8_t inst_id);
+static void check_lane_policy(struct ipc_lane_t *lane, uint8_t inst_id, uint8_t chan_id);
+static void init_chan_queue_cfg(struct ipc_chan_descr_t *ch, int dev_idx,
+                                uint8_t inst_id, uint8_t chan_id);
+static bool is_ring_full(struct ipc_lane_t *lane);
+static void push_rx_msg(struct ipc_chan_descr_t *ch, struct ipc_lane_t *lane, void *buf,
+                        uint32_t size, const struct ipc_rx_meta_t *meta);
+static void drain_held_buffs(struct ipc_chan_descr_t *ch);
+static void update_ring_high_water(struct ipc_chan_descr_t *ch);
+static void free_chan_rings(void);
 static void data_chan_rx_cb(void *cb_arg, const uint8_t instance,
                             int chan_id, void *buf, size_t size);
-static uint8_t get_device_idx(uint8_t inst_id, uint8_t chan_id);
-static uint8_t *get_next_pending_buff(struct ipc_chan_descr_t *ch, uint32_t *size);
-static uint8_t *get_next_free_buff(struct ipc_chan_descr_t *ch, uint32_t size);
+static int claim_pending_buff(struct ipc_file_t *f, size_t max_size,
+                              struct ipc_ring_msg_t *msg);
+static bool release_pending_buff(struct ipc_file_t *f, struct ipc_ring_msg_t *msg);
+static int consume_pending_buffs(struct ipc_file_t *f, struct ipc_lane_t *lane,
+                                 uint32_t count);
+static void abort_pending_buff(struct ipc_chan_descr_t *ch, struct ipc_ring_msg_t *msg);
+static uint8_t *get_next_free_buff(struct ipc_chan_descr_t *ch, struct ipc_lane_t *lane,
+                                   uint32_t size, const struct ipc_rx_meta_t *meta);
+static void publish_free_buff(struct ipc_lane_t *lane);
+static uint32_t get_num_pending_msg(struct ipc_chan_descr_t *ch);
+static uint32_t get_num_ring_slots(struct ipc_chan_descr_t *ch);
+static uint32_t get_file_pending_msg(struct ipc_file_t *f);
+static uint32_t get_shm_offset(phys_addr_t shm_phys, uint32_t shm_size, const void *buf,
+                               uint32_t size);
+static uint32_t get_tx_window_offset(struct ipc_chan_descr_t *ch, const void *buf);
+static void init_tx_windows(void);
+static void *acquire_tx_window_buf(struct ipc_chan_descr_t *ch);
+static void release_tx_window(struct ipc_file_t *f);
+static void put_tx_spare(struct ipc_chan_descr_t *ch, void *buf, uint32_t size);
+static void push_rx_ref(struct ipc_chan_descr_t *ch, void *buf, uint32_t size,
+                        const struct ipc_rx_meta_t *meta);
+static bool is_frag_store_busy(struct ipc_chan_descr_t *ch);
+static void push_rx_stored_msg(struct ipc_chan_descr_t *ch, struct ipc_lane_t *lane,
+                               void *buf, uint32_t size, const struct ipc_rx_meta_t *meta);
+static void record_rx_latency(struct ipc_chan_descr_t *ch, u64 stamp);
+static void release_rx_buff(struct ipc_chan_descr_t *ch, void *buf);
+static void refill_tx_window(struct ipc_file_t *f);
+static struct ipc_lane_t *select_rx_lane(struct ipc_chan_descr_t *ch, const uint8_t *buf,
+                                         uint32_t size);
+static long set_lane_filter(struct ipc_chan_descr_t *ch,
+                            const struct ipcf_lane_filter __user *ufilter);
+static void tx_retry_work_fn(struct work_struct *work);
+static long submit_tx_window(struct ipc_file_t *f,
+                             struct ipcf_tx_submit __user *usubmit);
 
 /* ==========================================================================
  * File operations
@@ -144,63 +750,148 @@ static uint8_t *get_next_free_buff(struct ipc_chan_descr_t *ch, uint32_t size);
 struct file_operations ipcf_file_operations = {
     .owner = THIS_MODULE,
     .open  = ipcf_open,
-    .read  = ipcf_read,
-    .write = ipcf_write,
+    .read_iter  = ipcf_read_iter,
+    .write_iter = ipcf_write_iter,
+    .splice_read = generic_file_splice_read,
+    .poll  = ipcf_poll,
+    .mmap  = ipcf_mmap,
+    .unlocked_ioctl = ipcf_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
     .release = ipcf_close,
 };
 
 /* ==========================================================================
  * IPCF Configuration
  * ==========================================================================*/
-/* IPCF memory pools configuration */
-static struct ipc_shm_pool_cfg buf_pools[] = {
+/* IPCF memory pools configuration of the echo channel */
+static struct ipc_shm_pool_cfg echo_buf_pools[] = {
     { .num_bufs = IPC_QUEUE_SIZE, .buf_size = IPCF_BUF_LEN}
 };
 
-/* IPCF channel configuration */
-static const struct ipc_shm_channel_cfg data_chan_cfg = {
-    .type = IPC_SHM_MANAGED,
-    .ch = {
-        .managed = {
-            .num_pools = ARRAY_SIZE(buf_pools),
-            .pools = buf_pools,
-            .rx_cb = data_chan_rx_cb,
-            .cb_arg = NULL,
-        },
-    }
+/* IPCF memory pools configuration of the idps_statistics channel. The size
+ * class layout shall match the configuration of the remote core */
+#if defined(IPC_SIZE_CLASS_POOLS)
+static struct ipc_shm_pool_cfg idps_buf_pools[] = {
+    { .num_bufs = IPC_QUEUE_SIZE_SMALL, .buf_size = IPCF_BUF_LEN_SMALL},
+    { .num_bufs = IPC_QUEUE_SIZE_MEDIUM, .buf_size = IPCF_BUF_LEN_MEDIUM},
+    { .num_bufs = IPC_QUEUE_SIZE_LARGE, .buf_size = IPCF_BUF_LEN_LARGE}
+};
+#else
+static struct ipc_shm_pool_cfg idps_buf_pools[] = {
+    { .num_bufs = IPC_QUEUE_SIZE, .buf_size = IPCF_BUF_LEN}
 };
+#endif /* defined(IPC_SIZE_CLASS_POOLS) */
+
+/* IPCF channel configuration, using the given memory pools. Pools shall be
+ * sorted by buffer size, IPCF picks the smallest buffer which fits a message.
+ * The callback argument is set to the channel descriptor at init */
+#define IPC_DATA_CHAN_CFG(chan_pools) {             \
+    .type = IPC_SHM_MANAGED,                        \
+    .ch = {                                         \
+        .managed = {                                \
+            .num_pools = ARRAY_SIZE(chan_pools),    \
+            .pools = chan_pools,                    \
+            .rx_cb = data_chan_rx_cb,               \
+            .cb_arg = NULL,                         \
+        },                                          \
+    }                                               \
+}
 
 /* IPCF instance 0 channels configuration */
 static struct ipc_shm_channel_cfg instance_0_channels[IPC_INST_0_CHAN_NUM] = {
-    data_chan_cfg,
-    data_chan_cfg
+    IPC_DATA_CHAN_CFG(echo_buf_pools),
+    IPC_DATA_CHAN_CFG(idps_buf_pools)
 };
 
-/* IPCF SHM compatible values */
-static const struct of_device_id ipcf_res_no_map_name[] = {
-    { .compatible = "nxp,s32g-ipcf-shm"}
+/* IPCF channels configuration of the other instances, generic data channels
+ * using the echo channel pools. Only the first IPC_INST_<n>_CHAN_NUM ones
+ * are used */
+#if (IPC_NUM_INSTANCES > 1)
+static struct ipc_shm_channel_cfg instance_1_channels[IPC_SHM_MAX_CHANNELS] = {
+    [0 ... IPC_SHM_MAX_CHANNELS - 1] = IPC_DATA_CHAN_CFG(echo_buf_pools)
+};
+#endif
+#if (IPC_NUM_INSTANCES > 2)
+static struct ipc_shm_channel_cfg instance_2_channels[IPC_SHM_MAX_CHANNELS] = {
+    [0 ... IPC_SHM_MAX_CHANNELS - 1] = IPC_DATA_CHAN_CFG(echo_buf_pools)
 };
+#endif
+#if (IPC_NUM_INSTANCES > 3)
+static struct ipc_shm_channel_cfg instance_3_channels[IPC_SHM_MAX_CHANNELS] = {
+    [0 ... IPC_SHM_MAX_CHANNELS - 1] = IPC_DATA_CHAN_CFG(echo_buf_pools)
+};
+#endif
+
+/* IPCF SHM compatible value, one node per instance */
+#define IPCF_SHM_COMPATIBLE             "nxp,s32g-ipcf-shm"
+
+/* IPCF shared memory configuration of an instance, exchanging with the
+ * given M7 core. The shared memory addresses are set by the init function,
+ * from the device tree */
+#define IPC_INST_SHM_CFG(inst_shm_size, rx_irq, m7_index, inst_channels, chan_num) { \
+    .shm_size = inst_shm_size,                                                  \
+    .inter_core_tx_irq = IPC_IRQ_NONE,                                          \
+    .inter_core_rx_irq = rx_irq,                                                \
+    .local_core = {                                                             \
+        .type = IPC_CORE_A53,                                                   \
+        .index = IPC_CORE_INDEX_0,                                              \
+        .trusted = IPC_CORE_INDEX_0 | IPC_CORE_INDEX_1 |                        \
+                IPC_CORE_INDEX_2 | IPC_CORE_INDEX_3                             \
+    },                                                                          \
+    .remote_core = {                                                            \
+        .type = IPC_CORE_M7,                                                    \
+        .index = m7_index,                                                      \
+    },                                                                          \
+    .num_channels = chan_num,                                                   \
+    .channels = inst_channels                                                   \
+}
 
 /* IPCF shared memory configuration */
 static struct ipc_shm_cfg shm_cfg[IPC_NUM_INSTANCES] = {
-    {
-        /* IPCF shared memory address will be used by init function. */
-        .shm_size = IPC_SHM_SIZE,
-        .inter_core_tx_irq = IPC_IRQ_NONE,
-        .inter_core_rx_irq = INTER_CORE_RX_IRQ,
-        .local_core = {
-            .type = IPC_CORE_A53,
-            .index = IPC_CORE_INDEX_0,
-            .trusted = IPC_CORE_INDEX_0 | IPC_CORE_INDEX_1 |
-                    IPC_CORE_INDEX_2 | IPC_CORE_INDEX_3
-        },
-        .remote_core = {
-            .type = IPC_CORE_M7,
-            .index = IPC_CORE_INDEX_0,
-        },
-        .num_channels = IPC_INST_0_CHAN_NUM,
-        .channels = instance_0_channels
-    }
+    IPC_INST_SHM_CFG(IPC_INST_0_SHM_SIZE, IPC_INST_0_RX_IRQ, IPC_CORE_INDEX_0,
+                     instance_0_channels, IPC_INST_0_CHAN_NUM),
+#if (IPC_NUM_INSTANCES > 1)
+    IPC_INST_SHM_CFG(IPC_INST_1_SHM_SIZE, IPC_INST_1_RX_IRQ, IPC_CORE_INDEX_1,
+                     instance_1_channels, IPC_INST_1_CHAN_NUM),
+#endif
+#if (IPC_NUM_INSTANCES > 2)
+    IPC_INST_SHM_CFG(IPC_INST_2_SHM_SIZE, IPC_INST_2_RX_IRQ, IPC_CORE_INDEX_2,
+                     instance_2_channels, IPC_INST_2_CHAN_NUM),
+#endif
+#if (IPC_NUM_INSTANCES > 3)
+    IPC_INST_SHM_CFG(IPC_INST_3_SHM_SIZE, IPC_INST_3_RX_IRQ, IPC_CORE_INDEX_3,
+                     instance_3_channels, IPC_INST_3_CHAN_NUM),
+#endif
+};
+
+/* Remote shared memory area size of each instance, the local area of an
+ * instance being given by shm_size in shm_cfg */
+static uint32_t inst_remote_shm_size[IPC_NUM_INSTANCES] = {
+    IPC_INST_0_REMOTE_SHM_SIZE,
+#if (IPC_NUM_INSTANCES > 1)
+    IPC_INST_1_REMOTE_SHM_SIZE,
+#endif
+#if (IPC_NUM_INSTANCES > 2)
+    IPC_INST_2_REMOTE_SHM_SIZE,
+#endif
+#if (IPC_NUM_INSTANCES > 3)
+    IPC_INST_3_REMOTE_SHM_SIZE,
+#endif
+};
+
+/* Remote M7 core index of each instance, the instance index unless given by
+ * the nxp,remote-core property of its device tree node */
+static uint8_t inst_m7_core[IPC_NUM_INSTANCES] = {
+    0,
+#if (IPC_NUM_INSTANCES > 1)
+    1,
+#endif
+#if (IPC_NUM_INSTANCES > 2)
+    2,
+#endif
+#if (IPC_NUM_INSTANCES > 3)
+    3,
+#endif
 };
 
 /* ==========================================================================
@@ -213,9 +904,46 @@ static struct class *ipcfshm_class = NULL;
 /* Character device major number */
 static int    dev_major = 0;
 
+/* Serializes the updates of the kernel subscribers of all channels */
+static DEFINE_MUTEX(ipcf_subscribers_lock);
+
+/* Serializes the updates of the lane filters of all channels */
+static DEFINE_MUTEX(ipcf_lane_filters_lock);
+
+/* Root directory of the driver in debugfs */
+static struct dentry *ipcf_debugfs_root = NULL;
+
+/* Platform device of the driver, reporting the link state */
+static struct platform_device *ipcf_pdev = NULL;
+
+/* Brings the link up once the remote core is running, then monitors it */
+static struct delayed_work ipcf_link_work;
+
+/* IPCF is initialized and the devices are created. Set with release semantics
+   once the channel descriptors are complete, read with acquire semantics by
+   the exported functions, which fail until then */
+static bool ipcf_initialized = false;
+
+/* The remote cores of the initialized instances are running */
+static bool ipcf_link_active = false;
+
+/* Next interval between two checks of the M7 core status, while waiting for
+   the remote core to start */
+static unsigned int ipcf_link_retry_ms = IPC_LINK_RETRY_MIN_MS;
+
+/* Error code of the last attempt to bring the link up, 0 if none failed */
+static int ipcf_link_err = 0;
+
 /* IPC channel descriptors, containing status and memory pool associated with
- * the channel */
-static struct ipc_chan_descr_t ipc_ch_descr[IPC_NUM_CHANNELS];
+ * the channel, allocated along with the round buffers */
+static struct ipc_chan_descr_t *ipc_ch_descr[IPC_NUM_CHANNELS];
+
+/* Number of initialized instances, set at init from the device tree */
+static uint8_t ipcf_num_instances = 0;
+
+/* Number of channels of the initialized instances, the first ones of
+ * ipc_ch_descr */
+static int ipcf_num_channels = 0;
 
 /* IPCF instance descriptor used to map the existing channels in the rootfs.
  * Each IPCF instance is linked to a core (set in the instance_name field)
@@ -224,360 +952,3848 @@ static struct ipc_chan_descr_t ipc_ch_descr[IPC_NUM_CHANNELS];
  * shown as:
  * /dev/ipcfshm/M7_0/echo
  * /dev/ipcfshm/M7_0/idps_statistics
+ * The other instances have generic data channels, without size prepending:
+ * /dev/ipcfshm/M7_1/chan_0
  */
+#define IPC_GENERIC_INST_DESCR(name, chan_num) {                                 \
+    .instance_name = name,                                                      \
+    .channel_count = chan_num,                                                  \
+    .channel_names = {"chan_0", "chan_1", "chan_2", "chan_3",                   \
+                      "chan_4", "chan_5", "chan_6", "chan_7"},                  \
+    .chan_queue_depth = {[0 ... IPC_SHM_MAX_CHANNELS - 1] = IPC_QUEUE_SIZE},    \
+    .chan_overflow_policy = {[0 ... IPC_SHM_MAX_CHANNELS - 1] = IPC_OVERFLOW_OVERWRITE}, \
+    .chan_prio_offset = {[0 ... IPC_SHM_MAX_CHANNELS - 1] = IPC_PRIO_OFFSET_NONE},   \
+    .rx_poll_period_us = 0,                                                     \
+    .rx_cpu = IPC_RX_CPU_ANY,                                                   \
+}
+
 static struct ipc_inst_descr_t inst_descr[IPC_NUM_INSTANCES] = {
     {
         .instance_name = "M7_0",
         .channel_count = IPC_INST_0_CHAN_NUM,
         .channel_names = {"echo", "idps_statistics"},
         .chan_prepend_size = {false, true},
+        .chan_batch_read = {false, true},
+        .chan_frame_hdr = {false, false},
+        .chan_tx_window_bufs = {8, 0},
+        .chan_frag_max_size = {0, 0},
+        .chan_multi_consumer = {false, false},
+        .chan_queue_depth = {IPC_QUEUE_SIZE, 4 * IPC_QUEUE_SIZE},
+        .chan_overflow_policy = {IPC_OVERFLOW_OVERWRITE, IPC_OVERFLOW_OVERWRITE},
+        .chan_num_lanes = {0, 0},
+        .chan_prio_offset = {IPC_PRIO_OFFSET_NONE, IPC_PRIO_OFFSET_NONE},
+        .chan_deferred_release = {false, false},
+        .chan_fan_out = {false, true},
+        .chan_netdev = {false, false},
+        .chan_idps_aggr = {false, true},
+        .chan_echo_bench = {true, false},
+        .rx_poll_period_us = 0,
+        .rx_cpu = IPC_RX_CPU_ANY,
     },
+#if (IPC_NUM_INSTANCES > 1)
+    IPC_GENERIC_INST_DESCR("M7_1", IPC_INST_1_CHAN_NUM),
+#endif
+#if (IPC_NUM_INSTANCES > 2)
+    IPC_GENERIC_INST_DESCR("M7_2", IPC_INST_2_CHAN_NUM),
+#endif
+#if (IPC_NUM_INSTANCES > 3)
+    IPC_GENERIC_INST_DESCR("M7_3", IPC_INST_3_CHAN_NUM),
+#endif
+};
+
+/* Polled RX state of the instances */
+static struct ipc_inst_poll_t ipc_inst_poll[IPC_NUM_INSTANCES];
+
+/* RX CPU affinity state of the instances */
+static struct ipc_inst_affinity_t ipc_inst_affinity[IPC_NUM_INSTANCES];
+
+/* Round buffer depth of each device, in device minor order, overriding the
+ * channel configuration when not 0 */
+static unsigned int queue_depth[IPC_NUM_CHANNELS];
+module_param_array(queue_depth, uint, NULL, 0444);
+MODULE_PARM_DESC(queue_depth, "Round buffer depth of each device, in device minor order");
+
+/* Overflow policy of each device, in device minor order, overriding the
+ * channel configuration when set */
+static char *overflow_policy[IPC_NUM_CHANNELS];
+module_param_array(overflow_policy, charp, NULL, 0444);
+MODULE_PARM_DESC(overflow_policy, "Overflow policy of each device, in device minor order: "
+                 "overwrite, drop or lossless");
+
+/* Number of priority lanes of each device, in device minor order, overriding
+ * the channel configuration when not 0 */
+static unsigned int num_lanes[IPC_NUM_CHANNELS];
+module_param_array(num_lanes, uint, NULL, 0444);
+MODULE_PARM_DESC(num_lanes, "Number of priority lanes of each device, in device minor order");
+
+/* Polled RX mode period of each instance, overriding the instance
+ * configuration when not 0 */
+static unsigned int rx_poll_us[IPC_NUM_INSTANCES];
+module_param_array(rx_poll_us, uint, NULL, 0444);
+MODULE_PARM_DESC(rx_poll_us, "Polled RX mode period of each instance in us, replacing its RX "
+                 "interrupt, 0 for interrupt driven RX");
+
+/* RX CPU affinity policy of each instance, overriding the instance
+ * configuration when set */
+static char *rx_cpu[IPC_NUM_INSTANCES];
+module_param_array(rx_cpu, charp, NULL, 0444);
+MODULE_PARM_DESC(rx_cpu, "RX CPU affinity of each instance: any, reader or a CPU number");
+
+/* Local and remote shared memory area sizes of each instance, overriding the
+ * device tree and the instance configuration when not 0 */
+static unsigned int shm_size[IPC_NUM_INSTANCES];
+module_param_array(shm_size, uint, NULL, 0444);
+MODULE_PARM_DESC(shm_size, "Local shared memory area size of each instance, in bytes");
+
+static unsigned int remote_shm_size[IPC_NUM_INSTANCES];
+module_param_array(remote_shm_size, uint, NULL, 0444);
+MODULE_PARM_DESC(remote_shm_size, "Remote shared memory area size of each instance, in bytes, "
+                 "i.e. the offset of the local area in the instance region");
+
+/* Time a blocking write waits for a TX buffer */
+static unsigned int tx_timeout_ms = IPC_TX_TIMEOUT_MS;
+module_param(tx_timeout_ms, uint, 0644);
+MODULE_PARM_DESC(tx_timeout_ms, "Time a blocking write waits for a TX buffer, in ms");
+
+/* Names of the overflow policies, as accepted by the overflow_policy parameter */
+static const char * const overflow_policy_names[] = {
+    [IPC_OVERFLOW_OVERWRITE] = "overwrite",
+    [IPC_OVERFLOW_DROP] = "drop",
+    [IPC_OVERFLOW_LOSSLESS] = "lossless",
 };
 
 /* ==========================================================================
  *                              LOCAL FUNCTIONS
  * ==========================================================================*/
- /**
- *  @brief  Gets the device index from the global channel descriptor
- *  @return IPC_INVALD/Channel ID
- */
-static uint8_t get_device_idx(uint8_t inst_id, uint8_t chan_id)
-{
-    uint8_t i;
-    uint8_t dev_id = IPC_INVALID;
-    for (i = 0; i < IPC_NUM_CHANNELS; i++) {
-        if (ipc_ch_descr[i].instance_id == inst_id &&
-            ipc_ch_descr[i].channel_id == chan_id) {
-            dev_id = i;
-            break;
-        }
-    }
-    return dev_id;
+/**
+ *  @brief          Gets the slot header of a message from the round buffer of
+ *                  a lane
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param lane     Pointer to the lane
+ *  @param msg_idx  Free running index of the message
+ *  @return         pointer to the slot header, followed by the payload
+ */
+static inline struct ipcf_rx_slot_hdr *get_ring_slot(struct ipc_chan_descr_t *ch,
+                                                     struct ipc_lane_t *lane, uint32_t msg_idx)
+{
+    return (struct ipcf_rx_slot_hdr *)((uint8_t *)lane->ring + IPC_RING_SLOTS_OFFSET +
+                                       (msg_idx & (lane->queue_depth - 1)) * ch->slot_size);
 }
 
 /**
- *  @brief          Gets the next available buffer from the round
- *                  pool associated with the channel descriptor
- *                  and saves the size of the input buffer in the channel descriptor.
- *                  If the buffer is full, the oldest data in the buffer will
- *                  be overwritten.
+ *  @brief          Gets the largest payload held by a slot of the round buffer
  *  @param ch       Pointer to the internal channel descriptor
- *  @param size     Data size
- *  @return         pointer to the allocated buffer
+ *  @return         payload size, larger messages being kept in the
+ *                  fragmentation store
  */
-static uint8_t *get_next_free_buff(struct ipc_chan_descr_t *ch, uint32_t size)
+static inline uint32_t get_slot_capacity(struct ipc_chan_descr_t *ch)
 {
-    uint8_t *pbuff = NULL;
-    uint32_t buff_idx = 0;
-
-    /* Last index in pool was reached, reset counter */
-    if (ch->free_buff_idx >= IPC_QUEUE_SIZE) {
-        ch->free_buff_idx = 0;
-    }
-    buff_idx = ch->free_buff_idx;
-
-    ch->num_pending_msg = min(IPC_QUEUE_SIZE, ch->num_pending_msg + 1);
-    /* get buff */
-    pbuff = ch->chan_pool[buff_idx];
-
-    /* Go to the next buffer */
-    ch->msg_size[buff_idx] = size;
-    /* mark buffer as not processed */
-    ch->msg_processed[buff_idx] = false;
-    /* Go to the next buffer */
-    ch->free_buff_idx++;
-
-    return pbuff;
+    return ch->slot_size - sizeof(struct ipcf_rx_slot_hdr);
 }
 
 /**
- *  @brief          Gets the oldest unprocessed buffer in the pool,
- *                  while updating the number of pending buffers.
+ *  @brief          Gets an entry of the fragmentation store
  *  @param ch       Pointer to the internal channel descriptor
- *  @param size     Pointer to a variable holding the buffer size
- *  @return         pointer to the allocated buffer
+ *  @param seq      Free running index of the message in the store
+ *  @return         pointer to the entry header, followed by the payload
  */
-static uint8_t *get_next_pending_buff(struct ipc_chan_descr_t *ch, uint32_t *size)
+static inline struct ipcf_rx_slot_hdr *get_frag_store_entry(struct ipc_chan_descr_t *ch,
+                                                            uint32_t seq)
 {
-    uint8_t *pbuff = NULL;
+    return (struct ipcf_rx_slot_hdr *)(ch->frag_store +
+                                       (seq & (IPC_FRAG_STORE_MSGS - 1)) * ch->frag_entry_size);
+}
 
-    /* Get next pending buffer index, ensuring that no illegal accesses take place */
-    uint32_t buff_idx = ((IPC_QUEUE_SIZE + ch->free_buff_idx - ch->num_pending_msg) % IPC_QUEUE_SIZE);
+/**
+ *  @brief          Gets the index of the oldest message still available in the
+ *                  round buffer of a lane. The receive callback never waits
+ *                  for the readers, so the messages which were overwritten
+ *                  while the readers were behind are skipped.
+ *  @param lane     Pointer to the lane
+ *  @param cursor   Pointer to the read cursor, the consumer index of the ring
+ *                  or the cursor of a fan-out reader
+ *  @param prod     Pointer to a variable holding the producer index, read with
+ *                  acquire semantics
+ *  @return         index of the oldest available message
+ */
+static inline uint32_t get_ring_consumer(struct ipc_lane_t *lane, const uint32_t *cursor,
+                                         uint32_t *prod)
+{
+    uint32_t cons = READ_ONCE(*cursor);
 
-    if (0 == ch->num_pending_msg) {
-        return NULL;
+    /* Pairs with the release in publish_free_buff, the slot content is
+       visible up to the producer index */
+    *prod = smp_load_acquire(&lane->ring->producer);
+    if ((*prod - cons) > lane->queue_depth) {
+        cons = *prod - lane->queue_depth;
     }
+    return cons;
+}
+
+/**
+ *  @brief          Gets the number of messages pending in the round buffers
+ *                  of all lanes
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         number of pending messages
+ */
+static uint32_t get_num_pending_msg(struct ipc_chan_descr_t *ch)
+{
+    uint32_t prod;
+    uint32_t cons;
+    uint32_t pending = 0;
+    uint8_t lane_id;
 
-    if (ch->msg_processed[buff_idx] == false) {
-        ch->msg_processed[buff_idx] = true;
-        *size = ch->msg_size[buff_idx];
-        pbuff = ch->chan_pool[buff_idx];
-        ch->num_pending_msg --;
+    for (lane_id = 0; lane_id < ch->num_lanes; lane_id++) {
+        cons = get_ring_consumer(&ch->lanes[lane_id], &ch->lanes[lane_id].ring->consumer, &prod);
+        pending += prod - cons;
     }
-    return pbuff;
+    return pending;
 }
 
 /**
- *  @brief  This function initializes local variables
- *          This function shall be called when the module is registered in order
- *          to avoid usage of values received at a previous registration of the
- *          device driver
- *  @return N/A
+ *  @brief          Gets the number of slots of the round buffers of all lanes
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         number of slots
  */
-static void init_state_vars(void)
+static uint32_t get_num_ring_slots(struct ipc_chan_descr_t *ch)
 {
-    int idx = 0;
-    int ch_idx = 0;
-    for (ch_idx = 0; ch_idx < IPC_NUM_CHANNELS; ch_idx++) {
-        ipc_ch_descr[ch_idx].num_pending_msg = 0;
-        ipc_ch_descr[ch_idx].free_buff_idx = 0;
-        for (idx = 0; idx < IPC_QUEUE_SIZE; idx++) {
-            ipc_ch_descr[ch_idx].msg_size[idx] = 0;
-            ipc_ch_descr[ch_idx].msg_processed[idx] = true;
-        }
+    uint32_t slots = 0;
+    uint8_t lane_id;
+
+    for (lane_id = 0; lane_id < ch->num_lanes; lane_id++) {
+        slots += ch->lanes[lane_id].queue_depth;
     }
+    return slots;
 }
 
 /**
- *  @brief          Callback function for the received messages.
- *
- *  @param arg      Callback argument
- *  @param inst_id  The instance for which the callback is called
- *  @param chan_id  Channel unique identifier for which the callback is called
- *  @param buf      Pointer to the received buffer
- *  @param instance The instance for which the callback is called
- *
- *  @return         N/A
+ *  @brief          Checks whether the readers of a channel share the consumer
+ *                  index of the ring, serialized via the consumer lock
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         true on multiple consumer channels
  */
-static void data_chan_rx_cb(void *arg, const uint8_t inst_id, int chan_id,
-                            void *buf, size_t size)
+static inline bool is_multi_consumer(struct ipc_chan_descr_t *ch)
 {
-    int err;
-    uint8_t dev_id = IPC_INVALID;
-    uint8_t *pbuff;
-    (void)arg;
-
-    if (IPCF_BUF_LEN >= size) {
-        dev_id = get_device_idx(inst_id, chan_id);
-        if (IPC_INVALID == dev_id) {
-            printk(KERN_ALERT "IPCF callback called for unknown device via \
-                   instance id: %d and channel %d \n", inst_id, chan_id);
-            goto free_ipc_buffer;
-        }
+    return inst_descr[ch->instance_id].chan_multi_consumer[ch->channel_id] && !ch->fan_out;
+}
 
-        pbuff = get_next_free_buff(&ipc_ch_descr[dev_id], size);
+/**
+ *  @brief          Checks whether a channel accepts a single reader, the
+ *                  single consumer of the ring
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         true on single consumer channels
+ */
+static inline bool is_exclusive_reader(struct ipc_chan_descr_t *ch)
+{
+    return !inst_descr[ch->instance_id].chan_multi_consumer[ch->channel_id] && !ch->fan_out;
+}
 
-        /* Copy to pool, these message will be available to user space via the
-           read function */
-        memcpy(pbuff, buf, size);
-    } else {
-        printk(KERN_ALERT "Received data does not fit \
-               in the existing buffers with for instance id %d, channel id %d,\
-               of size %zu \n", inst_id, chan_id, size);
-    }
+/**
+ *  @brief          Gets the events signaled to the pollers of a channel once
+ *                  messages are received, EPOLLPRI being reported as well on
+ *                  channels with priority lanes
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         mask of events
+ */
+static inline __poll_t get_rx_poll_events(struct ipc_chan_descr_t *ch)
+{
+    return EPOLLIN | EPOLLRDNORM | ((ch->num_lanes > 1) ? EPOLLPRI : 0);
+}
 
-free_ipc_buffer:
-    /* release the buffer */
-    err = ipc_shm_release_buf(inst_id, chan_id, buf);
-    if (err) {
-        printk(KERN_ALERT "failed to free buffer for instance %d, channel %d,"
-               "err code %d \n", inst_id, chan_id, err);
-    }
+/**
+ *  @brief          Gets the read cursor of an open file in a lane: its own
+ *                  cursor on fan-out channels, which have a single lane, the
+ *                  consumer index of the lane ring otherwise
+ *  @param f        Pointer to the open file state
+ *  @param lane     Pointer to the lane
+ *  @return         pointer to the read cursor
+ */
+static inline uint32_t *get_read_cursor(struct ipc_file_t *f, struct ipc_lane_t *lane)
+{
+    return f->ch->fan_out ? &f->cursor : &lane->ring->consumer;
 }
 
-/* ==========================================================================
- *                              GLOBAL FUNCTIONS
- * ==========================================================================*/
 /**
- *  @brief          Read function for Ipc character device driver.
- *                  This function is called whenever the character device driver
- *                  is open for reading, e.g: a "cat" operation.
- *                  It reads from the message queue and returns the first
- *                  unprocessed message to the user space.
- *  @param pfile    Pointer to the device driver file
- *  @param buffer   Pointer to the allocated buffer for reading
- *  @param length   Allocated buffer size
- *  @param offset   Pointer containing last read line from the device driver.
- *
- *  @return         size of read data
+ *  @brief          Gets the number of messages pending for an open file in
+ *                  a lane
+ *  @param f        Pointer to the open file state
+ *  @param lane     Pointer to the lane
+ *  @return         number of pending messages
  */
-ssize_t ipcf_read(struct file *pfile, char __user *buffer, size_t length,
-                  loff_t *offset)
+static uint32_t get_lane_pending_msg(struct ipc_file_t *f, struct ipc_lane_t *lane)
 {
-    size_t ret = 0;
-    struct ipc_chan_descr_t *ch = pfile->private_data;
-    uint8_t inst_id = ch->instance_id;
-    uint8_t chan_id = ch->channel_id;
-    uint32_t pbuff_size = 0;
-
-    uint8_t *pbuff = get_next_pending_buff(ch, &pbuff_size);
-    uint32_t pbuff_size_be = cpu_to_be32(pbuff_size);
-    if (NULL != pbuff) {
-        if (inst_descr[inst_id].chan_prepend_size[chan_id]) {
-            if (copy_to_user(buffer, &pbuff_size_be, sizeof(uint32_t))) {
-                printk(KERN_ALERT "failed to copy message size to user space \n");
-                /* Discard message */
-                return -EFAULT;
-            }
-            buffer += sizeof(uint32_t);
-            ret += sizeof(uint32_t);
-        }
-        /* Copy payload to user space */
-        if (copy_to_user(buffer, pbuff, pbuff_size)) {
-            printk(KERN_ALERT "failed to copy payload to user \n");
-            ret = -EFAULT;
-        } else {
-            ret += pbuff_size;
-        }
-    }
-    return ret;
+    uint32_t prod;
+    uint32_t cons = get_ring_consumer(lane, get_read_cursor(f, lane), &prod);
+
+    return prod - cons;
 }
 
 /**
-* @brief WRITE function for Ipc module.
-*        This function is called whenever the character device driver is open
-*        for writing, e.g: a "echo" operation. It reads from the user buffer
-*        the message intended to be sent, allocates a buffer from the ones
-*        available and sends it to the communication partner.
-*
-* @param  pfile     Pointer to the device driver file
-* @param  buffer    Pointer to the allocated buffer for reading
-* @param  length    Allocated buffer size
-* @param  offset    Pointer containing last read line from the device driver.
-*
-* @return number of written bytes.
-*/
-ssize_t ipcf_write(struct file *pfile, const char __user *buffer, size_t length,
-                   loff_t *offset)
+ *  @brief          Gets the number of messages pending for an open file
+ *  @param f        Pointer to the open file state
+ *  @return         number of pending messages
+ */
+static uint32_t get_file_pending_msg(struct ipc_file_t *f)
 {
-    size_t err;
-    char *buf = NULL;
-    struct ipc_chan_descr_t *ch = pfile->private_data;
-    uint8_t inst_id = ch->instance_id;
-    uint8_t chan_id = ch->channel_id;
+    uint32_t pending = 0;
+    uint8_t lane_id;
 
-    if (IPCF_BUF_LEN < length) {
-        length = IPCF_BUF_LEN;
+    for (lane_id = 0; lane_id < f->ch->num_lanes; lane_id++) {
+        pending += get_lane_pending_msg(f, &f->ch->lanes[lane_id]);
     }
+    return pending;
+}
 
-    buf = ipc_shm_acquire_buf(inst_id, chan_id, length);
-    if (!buf) {
-        printk(KERN_ALERT "failed to get buffer for instance ID %d channel ID"
-               " %d and size %d\n", inst_id, chan_id, (int)length);
-        return -ENOMEM;
-    }
+/**
+ *  @brief          Gets the next available buffer from the round
+ *                  pool of a lane of the channel
+ *                  and saves the size and metadata of the input buffer in its
+ *                  slot header.
+ *                  If the buffer is full, the oldest data in the buffer will
+ *                  be overwritten, the readers detect it via the slot sequence.
+ *                  The message becomes visible to the readers only after
+ *                  publish_free_buff is called.
+ *                  Shall only be called from the receive callback, which is
+ *                  the single producer of the ring.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param lane     Pointer to the lane
+ *  @param size     Data size
+ *  @param meta     Message metadata
+ *  @return         pointer to the allocated buffer
+ */
+static uint8_t *get_next_free_buff(struct ipc_chan_descr_t *ch, struct ipc_lane_t *lane,
+                                   uint32_t size, const struct ipc_rx_meta_t *meta)
+{
+    uint32_t msg_idx = lane->ring->producer;
+    struct ipcf_rx_slot_hdr *slot = get_ring_slot(ch, lane, msg_idx);
 
-    /* copy the buffer from user to ipc engine */
-    if (copy_from_user(buf, buffer, length)) {
-        printk(KERN_ALERT "failed to copy payload from user \n");
-        return -EFAULT;
-    }
+    /* Mark the slot as reused before its payload is overwritten, so that
+       readers still processing the previous message can detect it. Pairs
+       with the read barrier in release_pending_buff */
+    WRITE_ONCE(slot->seq, msg_idx);
+    smp_wmb();
+    WRITE_ONCE(slot->size, size);
+    WRITE_ONCE(slot->timestamp, meta->stamp);
+    WRITE_ONCE(slot->frame_seq, meta->seq);
+    WRITE_ONCE(slot->flags, meta->flags);
 
-    err = ipc_shm_tx(inst_id, chan_id, buf, length);
-    if (err) {
-        printk(KERN_ALERT "tx failed for instance ID %d channel ID %d, size "
-               "%d, error code %d\n", inst_id, chan_id, (int)length, (int)err);
-        return err;
-    }
-    return length;
+    return (uint8_t *)(slot + 1);
 }
 
 /**
-* @brief  Open function for ipc module
-*
-* @param  pinode    Pointer to the device driver directory
-* @param  pfile     Pointer to the device driver file
-*
-* @return 0
-*/
-int ipcf_open(struct inode *pinode, struct file *pfile)
+ *  @brief          Makes the message written in the buffer returned by
+ *                  get_next_free_buff visible to the readers
+ *  @param lane     Pointer to the lane
+ *  @return         N/A
+ */
+static void publish_free_buff(struct ipc_lane_t *lane)
 {
-    pfile->private_data = &ipc_ch_descr[iminor(pinode)];
-    return 0;
+    /* Payload shall be visible before the producer index */
+    smp_store_release(&lane->ring->producer, lane->ring->producer + 1);
 }
 
 /**
-* @brief  Close function for ipc module
-*
-* @param  pinode    Pointer to the device driver directory
-* @param  pfile     Pointer to the device driver file
-*
-* @return 0
-*/
-int ipcf_close(struct inode *pinode, struct file *pfile)
+ *  @brief          Checks whether the readers are at least a full round
+ *                  buffer of a lane behind the receive callback
+ *  @param lane     Pointer to the lane
+ *  @return         true if no slot is free
+ */
+static bool is_ring_full(struct ipc_lane_t *lane)
 {
-    (void) pinode;
-    (void) pfile;
-    return 0;
+    /* Pairs with the release of the consumer index, the readers are done
+       with the slots up to the consumer index */
+    return (lane->ring->producer - smp_load_acquire(&lane->ring->consumer)) >=
+           lane->queue_depth;
 }
 
 /**
-* @brief  This function ensures that the files have the same permissions
-*
-* @param  dev               Pointer to the device
-* @param  kobj_uevent_env   Event
-*
-* @return 0
-*/
-static int ipcfshm_uevent(struct device *dev, struct kobj_uevent_env *env)
+ *  @brief          Updates the maximum number of pending messages of a channel.
+ *                  Shall only be called by the producer of the round buffer.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         N/A
+ */
+static void update_ring_high_water(struct ipc_chan_descr_t *ch)
 {
-    add_uevent_var(env, "DEVMODE=%#o", 0666);
-    return 0;
+    uint32_t pending = get_num_pending_msg(ch);
+
+    if (pending > ch->stats.ring_high_water) {
+        WRITE_ONCE(ch->stats.ring_high_water, pending);
+    }
 }
 
 /**
-* @brief  This function will register character device driver for ipc
-*         This function is called whenever the character device driver being registered in the
-*         kernel via insmod function.
+ *  @brief          Copies a received message to the round buffer of a lane and
+ *                  makes it visible to the readers
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param lane     Pointer to the lane
+ *  @param buf      Pointer to the received buffer
+ *  @param size     Message size
+ *  @param meta     Message metadata
+ *  @return         N/A
+ */
+static void push_rx_msg(struct ipc_chan_descr_t *ch, struct ipc_lane_t *lane, void *buf,
+                        uint32_t size, const struct ipc_rx_meta_t *meta)
+{
+    uint8_t *pbuff;
+
+    if (size > get_slot_capacity(ch)) {
+        push_rx_stored_msg(ch, lane, buf, size, meta);
+        return;
+    }
+    pbuff = get_next_free_buff(ch, lane, size, meta);
+    /* Copy to pool, these message will be available to user space via the
+       read function */
+    memcpy(pbuff, buf, size);
+    publish_free_buff(lane);
+    update_ring_high_water(ch);
+}
+
+/**
+ *  @brief          Checks whether the next entry of the fragmentation store
+ *                  still holds a message pending on a lane which does not
+ *                  overwrite its messages
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         true if the entry cannot be reused
+ */
+static bool is_frag_store_busy(struct ipc_chan_descr_t *ch)
+{
+    const struct ipc_frag_store_ref_t *ref =
+        &ch->frag_store_refs[ch->frag_store_head & (IPC_FRAG_STORE_MSGS - 1)];
+
+    if ((NULL == ref->lane) || (IPC_OVERFLOW_OVERWRITE == ref->lane->overflow_policy)) {
+        return false;
+    }
+    /* Pairs with the release of the consumer index, the readers are done
+       with the messages before the consumer index */
+    return (int32_t)(ref->idx - smp_load_acquire(&ref->lane->ring->consumer)) >= 0;
+}
+
+/**
+ *  @brief          Copies a reassembled message larger than a slot to the
+ *                  next entry of the fragmentation store, then queues a
+ *                  reference to it in the round buffer of a lane and makes it
+ *                  visible to the readers
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param lane     Pointer to the lane
+ *  @param buf      Pointer to the reassembled message
+ *  @param size     Message size
+ *  @param meta     Message metadata
+ *  @return         N/A
+ */
+static void push_rx_stored_msg(struct ipc_chan_descr_t *ch, struct ipc_lane_t *lane,
+                               void *buf, uint32_t size, const struct ipc_rx_meta_t *meta)
+{
+    uint32_t seq = ch->frag_store_head++;
+    struct ipcf_rx_slot_hdr *entry = get_frag_store_entry(ch, seq);
+    struct ipc_frag_store_ref_t *store_ref = &ch->frag_store_refs[seq &
+                                                                   (IPC_FRAG_STORE_MSGS - 1)];
+    struct ipcf_rx_slot_ref *ref;
+
+    /* Mark the entry as reused before its payload is overwritten, as done
+       for the slots */
+    WRITE_ONCE(entry->seq, seq);
+    smp_wmb();
+    WRITE_ONCE(entry->size, size);
+    WRITE_ONCE(entry->timestamp, meta->stamp);
+    WRITE_ONCE(entry->frame_seq, meta->seq);
+    WRITE_ONCE(entry->flags, meta->flags);
+    memcpy(entry + 1, buf, size);
+
+    store_ref->lane = lane;
+    store_ref->idx = lane->ring->producer;
+    ref = (struct ipcf_rx_slot_ref *)get_next_free_buff(ch, lane, size, meta);
+    ref->offset = ch->frag_store_offset + (uint32_t)((uint8_t *)entry - ch->frag_store);
+    ref->seq = seq;
+    publish_free_buff(lane);
+    update_ring_high_water(ch);
+}
+
+/**
+ *  @brief          Queues a reference to a received IPCF buffer in the round
+ *                  buffer of a deferred release channel and makes it visible
+ *                  to the readers. The IPCF buffer is released once consumed.
+ *                  Such channels have a single lane.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param buf      Pointer to the received buffer
+ *  @param size     Message size
+ *  @param meta     Message metadata
+ *  @return         N/A
+ */
+static void push_rx_ref(struct ipc_chan_descr_t *ch, void *buf, uint32_t size,
+                        const struct ipc_rx_meta_t *meta)
+{
+    struct ipc_lane_t *lane = &ch->lanes[0];
+    uint32_t msg_idx = lane->ring->producer;
+    struct ipcf_rx_slot_ref *ref = (struct ipcf_rx_slot_ref *)get_next_free_buff(ch, lane, size,
+                                                                                 meta);
+
+    ref->offset = get_shm_offset(shm_cfg[ch->instance_id].remote_shm_addr,
+                                 inst_remote_shm_size[ch->instance_id], buf, size);
+    ch->rx_refs[msg_idx & (lane->queue_depth - 1)] = buf;
+    publish_free_buff(lane);
+    update_ring_high_water(ch);
+}
+
+/**
+ *  @brief          Releases a received IPCF buffer
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param buf      Pointer to the received buffer
+ *  @return         N/A
+ */
+static void release_rx_buff(struct ipc_chan_descr_t *ch, void *buf)
+{
+    int err = ipc_shm_release_buf(ch->instance_id, ch->channel_id, buf);
+    if (err) {
+        printk_ratelimited(KERN_ALERT "failed to free buffer for instance %d, channel %d,"
+                           "err code %d \n", ch->instance_id, ch->channel_id, err);
+    }
+}
+
+/**
+ *  @brief          Moves the IPCF buffers held on the lossless lanes of a
+ *                  channel to the slots freed by the readers, then releases
+ *                  them to IPCF.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         N/A
+ */
+static void drain_held_buffs(struct ipc_chan_descr_t *ch)
+{
+    unsigned long flags;
+    bool drained = false;
+    struct ipc_held_buf_t *held;
+    struct ipc_lane_t *lane;
+    uint8_t lane_id;
+
+    spin_lock_irqsave(&ch->producer_lock, flags);
+    for (lane_id = 0; lane_id < ch->num_lanes; lane_id++) {
+        lane = &ch->lanes[lane_id];
+        while ((ch->held_head[lane_id] != ch->held_tail[lane_id]) && !is_ring_full(lane)) {
+            held = &lane->held[ch->held_tail[lane_id] % lane->held_size];
+            push_rx_msg(ch, lane, held->buf, held->size, &held->meta);
+            release_rx_buff(ch, held->buf);
+            ch->held_tail[lane_id]++;
+            drained = true;
+        }
+    }
+    spin_unlock_irqrestore(&ch->producer_lock, flags);
+
+    if (drained) {
+        wake_up_interruptible_poll(&ch->rx_wait_q, get_rx_poll_events(ch));
+    }
+}
+
+/**
+ *  @brief          Adds the time elapsed since the arrival of a message to the
+ *                  RX latency histogram of its channel
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param stamp    Arrival time of the message, in ns
+ *  @return         N/A
+ */
+static void record_rx_latency(struct ipc_chan_descr_t *ch, u64 stamp)
+{
+    u64 latency = ktime_get_ns() - stamp;
+    uint32_t bucket = (latency > 1) ? ilog2(latency) : 0;
+
+    atomic64_inc(&ch->stats.rx_latency[min_t(uint32_t, bucket, IPC_LAT_HIST_BUCKETS - 1)]);
+}
+
+/**
+ *  @brief          Claims the oldest unprocessed buffer in the pool of the
+ *                  highest priority lane holding messages.
+ *                  On single consumer channels the buffer stays in the pool
+ *                  until it is released via release_pending_buff, on multiple
+ *                  consumer channels it is removed from the pool right away,
+ *                  so that no other reader can claim it.
+ *                  Shall be called with the read lock of the file held.
+ *  @param f        Pointer to the open file state of the reader
+ *  @param max_size Maximum payload size accepted by the caller
+ *  @param msg      Pointer to the claimed message
+ *  @return         0 on success, -ENODATA if no message is pending, -EMSGSIZE
+ *                  if the oldest message is larger than max_size
+ */
+static int claim_pending_buff(struct ipc_file_t *f, size_t max_size,
+                              struct ipc_ring_msg_t *msg)
+{
+    int err = 0;
+    uint32_t prod;
+    int lane_id;
+    struct ipc_chan_descr_t *ch = f->ch;
+    struct ipc_lane_t *lane = NULL;
+    uint32_t *cursor = NULL;
+    bool multi_consumer = is_multi_consumer(ch);
+
+    if (multi_consumer) {
+        spin_lock(&ch->consumer_lock);
+    }
+    /* Higher lanes have higher priority, lane 0 is the bulk lane */
+    for (lane_id = ch->num_lanes - 1; lane_id >= 0; lane_id--) {
+        cursor = get_read_cursor(f, &ch->lanes[lane_id]);
+        msg->idx = get_ring_consumer(&ch->lanes[lane_id], cursor, &prod);
+        if (prod != msg->idx) {
+            lane = &ch->lanes[lane_id];
+            break;
+        }
+    }
+    if (NULL == lane) {
+        err = -ENODATA;
+        goto unlock;
+    }
+    msg->lane = lane;
+    msg->slot = get_ring_slot(ch, lane, msg->idx);
+    msg->size = READ_ONCE(msg->slot->size);
+    msg->buf = ch->deferred_release ?
+               ch->rx_refs[msg->idx & (lane->queue_depth - 1)] : (msg->slot + 1);
+    msg->store = NULL;
+    if ((NULL != ch->frag_store) && (msg->size > get_slot_capacity(ch))) {
+        /* A stale reference still designates an entry of the store, the
+           slot sequence check discards the content on release */
+        msg->store_seq = READ_ONCE(((struct ipcf_rx_slot_ref *)msg->buf)->seq);
+        msg->store = get_frag_store_entry(ch, msg->store_seq);
+        msg->buf = msg->store + 1;
+    }
+    /* The metadata may be stale as well, on overwrite channels */
+    msg->meta.stamp = READ_ONCE(msg->slot->timestamp);
+    msg->meta.seq = READ_ONCE(msg->slot->frame_seq);
+    msg->meta.flags = READ_ONCE(msg->slot->flags);
+    /* Messages older than the claimed one were overwritten before being
+       consumed */
+    if (msg->idx != READ_ONCE(*cursor)) {
+        msg->meta.flags |= IPCF_FRAME_F_OVERWRITTEN;
+        WRITE_ONCE(f->overruns, f->overruns + (msg->idx - READ_ONCE(*cursor)));
+    }
+    /* The size may be stale if the slot was reused, this is detected when
+       the message is released */
+    if (msg->size > max_size) {
+        err = -EMSGSIZE;
+        goto unlock;
+    }
+    if (multi_consumer) {
+        smp_store_release(cursor, msg->idx + 1);
+    }
+unlock:
+    if (multi_consumer) {
+        spin_unlock(&ch->consumer_lock);
+    }
+    return err;
+}
+
+/**
+ *  @brief          Releases a buffer claimed via claim_pending_buff, after its
+ *                  content was consumed, while updating the number of pending
+ *                  buffers. On deferred release channels, the IPCF buffer of
+ *                  the message is released as well.
+ *                  Shall be called with the read lock of the file held.
+ *  @param f        Pointer to the open file state of the reader
+ *  @param msg      Pointer to the claimed message
+ *  @return         true if the consumed content is valid, false if the slot
+ *                  was overwritten by a newer message in the meantime
+ */
+static bool release_pending_buff(struct ipc_file_t *f, struct ipc_ring_msg_t *msg)
+{
+    bool valid;
+    struct ipc_chan_descr_t *ch = f->ch;
+
+    /* Content shall be consumed before checking the slot sequence */
+    smp_rmb();
+    valid = (READ_ONCE(msg->slot->seq) == msg->idx) && (msg->size <= ch->max_msg_size) &&
+            ((NULL == msg->store) || (READ_ONCE(msg->store->seq) == msg->store_seq));
+    if (!is_multi_consumer(ch)) {
+        smp_store_release(get_read_cursor(f, msg->lane), msg->idx + 1);
+    }
+    if (!valid) {
+        WRITE_ONCE(f->overruns, f->overruns + 1);
+    }
+    if (ch->deferred_release) {
+        release_rx_buff(ch, msg->buf);
+    } else if (IPC_OVERFLOW_LOSSLESS == msg->lane->overflow_policy) {
+        drain_held_buffs(ch);
+    }
+    if (valid) {
+        record_rx_latency(ch, msg->meta.stamp);
+    }
+    return valid;
+}
+
+/**
+ *  @brief          Evaluates a filter rule on a message
+ *  @param rule     Pointer to the filter rule
+ *  @param buf      Pointer to the payload
+ *  @param size     Payload size
+ *  @return         true if the rule is true for the message
+ */
+static bool match_filter_rule(const struct ipcf_filter_rule *rule, const uint8_t *buf,
+                              uint32_t size)
+{
+    uint32_t field;
+
+    if (((uint32_t)rule->offset + rule->width) > size) {
+        return false;
+    }
+    if (1 == rule->width) {
+        field = buf[rule->offset];
+    } else if (2 == rule->width) {
+        field = get_unaligned_le16(buf + rule->offset);
+    } else {
+        field = get_unaligned_le32(buf + rule->offset);
+    }
+    field &= rule->mask;
+
+    return (IPCF_FILTER_OP_EQ == rule->op) ? (field == rule->value) : (field != rule->value);
+}
+
+/**
+ *  @brief          Evaluates a filter on a message
+ *  @param rules    Pointer to the filter
+ *  @param buf      Pointer to the payload
+ *  @param size     Payload size
+ *  @return         true if the filter is true for the message
+ */
+static bool match_filter(const struct ipcf_filter *rules, const uint8_t *buf, uint32_t size)
+{
+    bool match_any = rules->flags & IPCF_FILTER_F_MATCH_ANY;
+    uint32_t idx;
+
+    for (idx = 0; idx < rules->num_rules; idx++) {
+        if (match_filter_rule(&rules->rules[idx], buf, size) == match_any) {
+            return match_any;
+        }
+    }
+    return !match_any;
+}
+
+/**
+ *  @brief          Evaluates the filter of an open file on a claimed message
+ *  @param f        Pointer to the open file state of the reader
+ *  @param msg      Pointer to the claimed message
+ *  @return         true if the message shall be read, always without filter
+ */
+static bool match_file_filter(struct ipc_file_t *f, const struct ipc_ring_msg_t *msg)
+{
+    const struct ipc_file_filter_t *filter;
+    bool match = true;
+    /* The size may be stale, the content is discarded on release anyway */
+    uint32_t size = min_t(uint32_t, msg->size, f->ch->max_msg_size);
+
+    rcu_read_lock();
+    filter = rcu_dereference(f->filter);
+    if (NULL != filter) {
+        match = match_filter(&filter->rules, msg->buf, size);
+    }
+    rcu_read_unlock();
+
+    return match;
+}
+
+/**
+ *  @brief          Checks the rules of a filter copied from user space
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param rules    Pointer to the filter
+ *  @return         0 on success, -EINVAL if a rule is invalid
+ */
+static int check_filter(struct ipc_chan_descr_t *ch, const struct ipcf_filter *rules)
+{
+    const struct ipcf_filter_rule *rule;
+    uint32_t idx;
+
+    if ((rules->num_rules > IPCF_FILTER_MAX_RULES) ||
+        (rules->flags & ~IPCF_FILTER_F_MATCH_ANY)) {
+        return -EINVAL;
+    }
+    for (idx = 0; idx < rules->num_rules; idx++) {
+        rule = &rules->rules[idx];
+        if (((1 != rule->width) && (2 != rule->width) && (4 != rule->width)) ||
+            (rule->op > IPCF_FILTER_OP_NE) ||
+            (((uint32_t)rule->offset + rule->width) > ch->max_msg_size)) {
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+/**
+ *  @brief          Installs the message filter of an open file, or removes it
+ *  @param f        Pointer to the open file state of the reader
+ *  @param ufilter  User space pointer to the filter
+ *  @return         0 on success, -EFAULT, -EINVAL if a rule is invalid or the
+ *                  channel has multiple consumers, -ENOMEM
+ */
+static int set_file_filter(struct ipc_file_t *f, const struct ipcf_filter __user *ufilter)
+{
+    struct ipc_file_filter_t *filter;
+    struct ipc_file_filter_t *old;
+
+    /* The messages skipped by a reader would be lost for the other ones */
+    if (is_multi_consumer(f->ch)) {
+        return -EINVAL;
+    }
+    filter = kmalloc(sizeof(*filter), GFP_KERNEL);
+    if (NULL == filter) {
+        return -ENOMEM;
+    }
+    if (copy_from_user(&filter->rules, ufilter, sizeof(filter->rules))) {
+        kfree(filter);
+        return -EFAULT;
+    }
+    if (0 != check_filter(f->ch, &filter->rules)) {
+        kfree(filter);
+        return -EINVAL;
+    }
+    if (0 == filter->rules.num_rules) {
+        kfree(filter);
+        filter = NULL;
+    }
+
+    mutex_lock(&f->filter_lock);
+    old = rcu_replace_pointer(f->filter, filter, lockdep_is_held(&f->filter_lock));
+    mutex_unlock(&f->filter_lock);
+    if (NULL != old) {
+        kfree_rcu(old, rcu);
+    }
+    return 0;
+}
+
+/**
+ *  @brief          Installs the filter selecting the messages of a priority
+ *                  lane, or removes it. The filters of all the lanes are
+ *                  replaced at once, so that the receive callback evaluates
+ *                  a consistent set.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param ufilter  User space pointer to the lane filter
+ *  @return         0 on success, -EPERM, -EFAULT, -EINVAL if the lane or a
+ *                  rule is invalid, -ENOMEM
+ */
+static long set_lane_filter(struct ipc_chan_descr_t *ch,
+                            const struct ipcf_lane_filter __user *ufilter)
+{
+    struct ipcf_lane_filter lane_filter;
+    struct ipc_lane_filters_t *filters;
+    struct ipc_lane_filters_t *old;
+    uint32_t lane_id;
+    bool used = false;
+
+    /* Lane filters apply to all the readers of the channel */
+    if (!capable(CAP_SYS_ADMIN)) {
+        return -EPERM;
+    }
+    if (copy_from_user(&lane_filter, ufilter, sizeof(lane_filter))) {
+        return -EFAULT;
+    }
+    if ((0 == lane_filter.lane) || (lane_filter.lane >= ch->num_lanes) ||
+        (0 != lane_filter.reserved) || (0 != check_filter(ch, &lane_filter.filter))) {
+        return -EINVAL;
+    }
+    filters = kzalloc(sizeof(*filters), GFP_KERNEL);
+    if (NULL == filters) {
+        return -ENOMEM;
+    }
+
+    mutex_lock(&ipcf_lane_filters_lock);
+    old = rcu_dereference_protected(ch->lane_filters, lockdep_is_held(&ipcf_lane_filters_lock));
+    if (NULL != old) {
+        memcpy(filters->lanes, old->lanes, sizeof(filters->lanes));
+    }
+    filters->lanes[lane_filter.lane] = lane_filter.filter;
+    for (lane_id = 1; lane_id < ch->num_lanes; lane_id++) {
+        used = used || (0 != filters->lanes[lane_id].num_rules);
+    }
+    if (!used) {
+        kfree(filters);
+        filters = NULL;
+    }
+    rcu_assign_pointer(ch->lane_filters, filters);
+    mutex_unlock(&ipcf_lane_filters_lock);
+    if (NULL != old) {
+        kfree_rcu(old, rcu);
+    }
+    return 0;
+}
+
+/**
+ *  @brief          Selects the priority lane of a received message: the
+ *                  highest lane whose filter matches, else the lane given
+ *                  by the priority byte of the message, else lane 0
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param buf      Pointer to the payload
+ *  @param size     Payload size
+ *  @return         pointer to the lane
+ */
+static struct ipc_lane_t *select_rx_lane(struct ipc_chan_descr_t *ch, const uint8_t *buf,
+                                         uint32_t size)
+{
+    const struct ipc_lane_filters_t *filters;
+    uint8_t lane_id = 0;
+    uint8_t idx;
+
+    if (1 == ch->num_lanes) {
+        return &ch->lanes[0];
+    }
+    rcu_read_lock();
+    filters = rcu_dereference(ch->lane_filters);
+    if (NULL != filters) {
+        for (idx = ch->num_lanes - 1; idx > 0; idx--) {
+            if ((0 != filters->lanes[idx].num_rules) &&
+                match_filter(&filters->lanes[idx], buf, size)) {
+                lane_id = idx;
+                break;
+            }
+        }
+    }
+    rcu_read_unlock();
+    if ((0 == lane_id) && (IPC_PRIO_OFFSET_NONE != ch->prio_offset) &&
+        ((uint32_t)ch->prio_offset < size)) {
+        lane_id = min_t(uint8_t, buf[ch->prio_offset], ch->num_lanes - 1);
+    }
+    return &ch->lanes[lane_id];
+}
+
+/**
+ *  @brief          Gives up a buffer claimed via claim_pending_buff, whose
+ *                  content could not be consumed. On single consumer channels
+ *                  the message stays in the pool, on multiple consumer channels
+ *                  it was already removed and is discarded.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param msg      Pointer to the claimed message
+ *  @return         N/A
+ */
+static void abort_pending_buff(struct ipc_chan_descr_t *ch, struct ipc_ring_msg_t *msg)
+{
+    if (ch->deferred_release && is_multi_consumer(ch)) {
+        release_rx_buff(ch, msg->buf);
+    }
+}
+
+/**
+ *  @brief          Removes the given number of messages from the pool of a
+ *                  lane, after their content was consumed in place by a reader
+ *                  mapping the round buffer. On deferred release channels, the
+ *                  IPCF buffers of the messages are released as well.
+ *  @param f        Pointer to the open file state of the reader
+ *  @param lane     Pointer to the lane
+ *  @param count    Number of messages to remove
+ *  @return         0 on success, -EINVAL if less messages are pending
+ */
+static int consume_pending_buffs(struct ipc_file_t *f, struct ipc_lane_t *lane,
+                                 uint32_t count)
+{
+    int err = 0;
+    uint32_t prod;
+    uint32_t cons;
+    uint32_t idx;
+    struct ipc_chan_descr_t *ch = f->ch;
+    uint32_t *cursor = get_read_cursor(f, lane);
+    bool multi_consumer = is_multi_consumer(ch);
+
+    mutex_lock(&f->read_lock);
+    if (multi_consumer) {
+        spin_lock(&ch->consumer_lock);
+    }
+    cons = get_ring_consumer(lane, cursor, &prod);
+    if (count > (prod - cons)) {
+        err = -EINVAL;
+    } else {
+        for (idx = cons; idx != (cons + count); idx++) {
+            record_rx_latency(ch, READ_ONCE(get_ring_slot(ch, lane, idx)->timestamp));
+            if (ch->deferred_release) {
+                release_rx_buff(ch, ch->rx_refs[idx & (lane->queue_depth - 1)]);
+            }
+        }
+        if (cons != READ_ONCE(*cursor)) {
+            WRITE_ONCE(f->overruns, f->overruns + (cons - READ_ONCE(*cursor)));
+        }
+        smp_store_release(cursor, cons + count);
+    }
+    if (multi_consumer) {
+        spin_unlock(&ch->consumer_lock);
+    }
+    mutex_unlock(&f->read_lock);
+    if (IPC_OVERFLOW_LOSSLESS == lane->overflow_policy) {
+        drain_held_buffs(ch);
+    }
+    return err;
+}
+
+/**
+ *  @brief          Gets the largest buffer size of the IPCF memory pools
+ *                  configured for a channel
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @return         buffer size
+ */
+static uint32_t get_chan_max_buf_size(uint8_t inst_id, uint8_t chan_id)
+{
+    int idx;
+    uint32_t max_size = 0;
+    const struct ipc_shm_managed_cfg *cfg = &shm_cfg[inst_id].channels[chan_id].ch.managed;
+
+    for (idx = 0; idx < cfg->num_pools; idx++) {
+        max_size = max(max_size, cfg->pools[idx].buf_size);
+    }
+    return max_size;
+}
+
+/**
+ *  @brief          Gets the smallest buffer size of the IPCF memory pools
+ *                  configured for a channel
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @return         buffer size
+ */
+static uint32_t get_chan_min_buf_size(uint8_t inst_id, uint8_t chan_id)
+{
+    int idx;
+    uint32_t min_size = U32_MAX;
+    const struct ipc_shm_managed_cfg *cfg = &shm_cfg[inst_id].channels[chan_id].ch.managed;
+
+    for (idx = 0; idx < cfg->num_pools; idx++) {
+        min_size = min(min_size, cfg->pools[idx].buf_size);
+    }
+    return min_size;
+}
+
+/**
+ *  @brief          Gets the total number of buffers of the IPCF memory pools
+ *                  configured for a channel
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @return         number of buffers
+ */
+static uint32_t get_chan_num_bufs(uint8_t inst_id, uint8_t chan_id)
+{
+    int idx;
+    uint32_t num_bufs = 0;
+    const struct ipc_shm_managed_cfg *cfg = &shm_cfg[inst_id].channels[chan_id].ch.managed;
+
+    for (idx = 0; idx < cfg->num_pools; idx++) {
+        num_bufs += cfg->pools[idx].num_bufs;
+    }
+    return num_bufs;
+}
+
+/**
+ *  @brief          Gets an upper bound of the size taken by the channels of
+ *                  an instance in each of its shared memory areas, the pools
+ *                  being laid out the same way in the local and remote areas
+ *  @param inst_id  Instance id
+ *  @return         size in bytes
+ */
+static uint32_t get_inst_shm_footprint(uint8_t inst_id)
+{
+    int chan_id, idx;
+    uint64_t size = 0;
+    const struct ipc_shm_managed_cfg *cfg;
+
+    for (chan_id = 0; chan_id < shm_cfg[inst_id].num_channels; chan_id++) {
+        cfg = &shm_cfg[inst_id].channels[chan_id].ch.managed;
+        size += 2 * (IPC_SHM_QUEUE_HDR_SIZE +
+                     (uint64_t)get_chan_num_bufs(inst_id, chan_id) * IPC_SHM_BD_SIZE);
+        for (idx = 0; idx < cfg->num_pools; idx++) {
+            size += 2 * (IPC_SHM_QUEUE_HDR_SIZE +
+                         (uint64_t)cfg->pools[idx].num_bufs * IPC_SHM_BUF_IDX_SIZE);
+            size += (uint64_t)cfg->pools[idx].num_bufs * cfg->pools[idx].buf_size;
+        }
+    }
+    return (uint32_t)min_t(uint64_t, size, U32_MAX);
+}
+
+/**
+ *  @brief          Applies the fallbacks of the lossless policy to a lane
+ *  @param lane     Pointer to the lane
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @return         N/A
+ */
+static void check_lane_policy(struct ipc_lane_t *lane, uint8_t inst_id, uint8_t chan_id)
+{
+    /* Claimed messages of multiple consumer channels may still be overwritten
+       while being copied, which cannot be handled without loss */
+    if ((IPC_OVERFLOW_LOSSLESS == lane->overflow_policy) &&
+        inst_descr[inst_id].chan_multi_consumer[chan_id]) {
+        printk(KERN_WARNING "Lossless policy is not supported with multiple "
+               "consumers, using drop for %s/%s\n", inst_descr[inst_id].instance_name,
+               inst_descr[inst_id].channel_names[chan_id]);
+        lane->overflow_policy = IPC_OVERFLOW_DROP;
+    }
+    if ((IPC_OVERFLOW_LOSSLESS == lane->overflow_policy) &&
+        (0 != inst_descr[inst_id].chan_frag_max_size[chan_id])) {
+        printk(KERN_WARNING "Lossless policy is not supported with fragmentation, "
+               "using drop for %s/%s\n", inst_descr[inst_id].instance_name,
+               inst_descr[inst_id].channel_names[chan_id]);
+        lane->overflow_policy = IPC_OVERFLOW_DROP;
+    }
+}
+
+/**
+ *  @brief          Sets the priority lanes of a device, with the round buffer
+ *                  depth and overflow policy of each one, from the channel
+ *                  configuration and the module parameters
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param dev_idx  Device index
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @return         N/A
+ */
+static void init_chan_queue_cfg(struct ipc_chan_descr_t *ch, int dev_idx,
+                                uint8_t inst_id, uint8_t chan_id)
+{
+    int policy;
+    uint8_t lane_id;
+    struct ipc_lane_t *lane;
+    bool policy_param = false;
+    uint32_t lanes = inst_descr[inst_id].chan_num_lanes[chan_id];
+    uint32_t depth = inst_descr[inst_id].chan_queue_depth[chan_id];
+    enum ipc_overflow_policy_t chan_policy = inst_descr[inst_id].chan_overflow_policy[chan_id];
+
+    if (0 != queue_depth[dev_idx]) {
+        depth = queue_depth[dev_idx];
+    }
+    if (NULL != overflow_policy[dev_idx]) {
+        policy = sysfs_match_string(overflow_policy_names, overflow_policy[dev_idx]);
+        if (policy < 0) {
+            printk(KERN_WARNING "Unknown overflow policy %s, using %s for %s/%s\n",
+                   overflow_policy[dev_idx], overflow_policy_names[chan_policy],
+                   inst_descr[inst_id].instance_name,
+                   inst_descr[inst_id].channel_names[chan_id]);
+        } else {
+            /* Overrides the policy of all the lanes */
+            chan_policy = policy;
+            policy_param = true;
+        }
+    }
+    if (0 != num_lanes[dev_idx]) {
+        lanes = num_lanes[dev_idx];
+    }
+    ch->num_lanes = clamp_t(uint32_t, lanes, 1, IPCF_RX_MAX_LANES);
+    ch->prio_offset = inst_descr[inst_id].chan_prio_offset[chan_id];
+
+    /* The IPCF pools bound the number of referenced buffers, the round buffer
+       is sized to hold all of them and never overflows */
+    ch->deferred_release = inst_descr[inst_id].chan_deferred_release[chan_id];
+    ch->fan_out = inst_descr[inst_id].chan_fan_out[chan_id];
+    /* Fragments are copied to the reassembly buffer, their IPCF buffers can
+       be neither referenced by the round buffer nor held */
+    if (ch->deferred_release && (0 != inst_descr[inst_id].chan_frag_max_size[chan_id])) {
+        printk(KERN_WARNING "Deferred release is not supported with fragmentation, "
+               "disabled for %s/%s\n", inst_descr[inst_id].instance_name,
+               inst_descr[inst_id].channel_names[chan_id]);
+        ch->deferred_release = false;
+    }
+    if (ch->deferred_release && ch->fan_out) {
+        printk(KERN_WARNING "Fan-out is not supported with deferred release, "
+               "disabled for %s/%s\n", inst_descr[inst_id].instance_name,
+               inst_descr[inst_id].channel_names[chan_id]);
+        ch->fan_out = false;
+    }
+    /* Deferred release readers consume the IPCF buffers in reception order,
+       fan-out readers only track a single cursor */
+    if ((ch->num_lanes > 1) && (ch->deferred_release || ch->fan_out)) {
+        printk(KERN_WARNING "Priority lanes are not supported with deferred release "
+               "or fan-out, disabled for %s/%s\n", inst_descr[inst_id].instance_name,
+               inst_descr[inst_id].channel_names[chan_id]);
+        ch->num_lanes = 1;
+    }
+    if (1 == ch->num_lanes) {
+        ch->prio_offset = IPC_PRIO_OFFSET_NONE;
+    }
+
+    lane = &ch->lanes[0];
+    if (ch->deferred_release) {
+        lane->queue_depth = roundup_pow_of_two(get_chan_num_bufs(inst_id, chan_id));
+        lane->overflow_policy = IPC_OVERFLOW_DROP;
+        return;
+    }
+
+    /* The receive callback does not track the cursors of the fan-out readers,
+       the round buffer can only overwrite the oldest messages */
+    if (ch->fan_out) {
+        if (IPC_OVERFLOW_OVERWRITE != chan_policy) {
+            printk(KERN_WARNING "Fan-out only supports the overwrite policy, "
+                   "used for %s/%s\n", inst_descr[inst_id].instance_name,
+                   inst_descr[inst_id].channel_names[chan_id]);
+        }
+        lane->queue_depth = roundup_pow_of_two(clamp_t(uint32_t, depth, 1, IPC_MAX_QUEUE_SIZE));
+        lane->overflow_policy = IPC_OVERFLOW_OVERWRITE;
+        return;
+    }
+
+    for (lane_id = 0; lane_id < ch->num_lanes; lane_id++) {
+        lane = &ch->lanes[lane_id];
+        lane->queue_depth = depth;
+        lane->overflow_policy = chan_policy;
+        if (ch->num_lanes > 1) {
+            if (0 != inst_descr[inst_id].chan_lane_depth[chan_id][lane_id]) {
+                lane->queue_depth = inst_descr[inst_id].chan_lane_depth[chan_id][lane_id];
+            }
+            if (!policy_param) {
+                lane->overflow_policy = inst_descr[inst_id].chan_lane_policy[chan_id][lane_id];
+            }
+        }
+        lane->queue_depth = roundup_pow_of_two(clamp_t(uint32_t, lane->queue_depth, 1,
+                                                       IPC_MAX_QUEUE_SIZE));
+        check_lane_policy(lane, inst_id, chan_id);
+    }
+}
+
+/**
+ *  @brief  This function allocates the descriptors and the round buffers of
+ *          all channels. The slots of each buffer are sized to fit the
+ *          largest message of the channel. The buffers are allocated page
+ *          aligned, in order to allow their mapping in user space.
+ *  @return 0 on success, -ENOMEM otherwise
+ */
+static int alloc_chan_rings(void)
+{
+    int cdev_idx = 0;
+    int inst_id = 0;
+    int ch_id = 0;
+    uint8_t lane_id;
+    uint8_t *ring;
+    struct ipc_lane_t *lane;
+    struct ipc_chan_descr_t *ch;
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        for (ch_id = 0; ch_id < inst_descr[inst_id].channel_count; ch_id++) {
+            ch = kzalloc(sizeof(*ch), GFP_KERNEL);
+            if (NULL == ch) {
+                free_chan_rings();
+                return -ENOMEM;
+            }
+            ipc_ch_descr[cdev_idx] = ch;
+            init_chan_queue_cfg(ch, cdev_idx++, inst_id, ch_id);
+            ch->max_buf_size = get_chan_max_buf_size(inst_id, ch_id);
+            ch->max_msg_size = ch->max_buf_size;
+            ch->min_msg_size = get_chan_min_buf_size(inst_id, ch_id);
+            if (0 != inst_descr[inst_id].chan_frag_max_size[ch_id]) {
+                ch->max_msg_size = min_t(uint32_t, IPC_FRAG_MAX_MSG_SIZE,
+                                         inst_descr[inst_id].chan_frag_max_size[ch_id]);
+                ch->frag_rx = kvzalloc(sizeof(*ch->frag_rx) + ch->max_msg_size, GFP_KERNEL);
+                if (NULL == ch->frag_rx) {
+                    free_chan_rings();
+                    return -ENOMEM;
+                }
+            }
+            /* Slots never share a cache line, the receive callback writing
+               the next one while the readers process the previous ones. On
+               channels using fragmentation the slots are sized to the IPCF
+               buffers, larger messages being kept in the fragmentation
+               store */
+            ch->slot_size = ALIGN(sizeof(struct ipcf_rx_slot_hdr) + (ch->deferred_release ?
+                                  sizeof(struct ipcf_rx_slot_ref) :
+                                  max_t(uint32_t, ch->max_buf_size,
+                                        sizeof(struct ipcf_rx_slot_ref))),
+                                  IPCF_RX_RING_LINE_SIZE);
+            /* The rings of the lanes follow each other in a single mapping,
+               each one starting on a page */
+            ch->ring_size = 0;
+            for (lane_id = 0; lane_id < ch->num_lanes; lane_id++) {
+                ch->lanes[lane_id].ring_offset = ch->ring_size;
+                ch->ring_size += PAGE_ALIGN(IPC_RING_SLOTS_OFFSET +
+                                            ch->lanes[lane_id].queue_depth * ch->slot_size);
+            }
+            if ((NULL != ch->frag_rx) && (ch->max_msg_size > get_slot_capacity(ch))) {
+                ch->frag_store_offset = ch->ring_size;
+                ch->frag_entry_size = ALIGN(sizeof(struct ipcf_rx_slot_hdr) + ch->max_msg_size,
+                                            IPCF_RX_RING_LINE_SIZE);
+                ch->ring_size += PAGE_ALIGN(IPC_FRAG_STORE_MSGS * ch->frag_entry_size);
+            }
+            ring = vmalloc_user(ch->ring_size);
+            if (NULL == ring) {
+                free_chan_rings();
+                return -ENOMEM;
+            }
+            if (0 != ch->frag_entry_size) {
+                ch->frag_store = ring + ch->frag_store_offset;
+            }
+            for (lane_id = 0; lane_id < ch->num_lanes; lane_id++) {
+                ch->lanes[lane_id].ring = (struct ipcf_rx_ring_hdr *)(ring +
+                                          ch->lanes[lane_id].ring_offset);
+            }
+            if (ch->deferred_release) {
+                ch->rx_refs = kcalloc(ch->lanes[0].queue_depth, sizeof(*ch->rx_refs),
+                                      GFP_KERNEL);
+                if (NULL == ch->rx_refs) {
+                    free_chan_rings();
+                    return -ENOMEM;
+                }
+            }
+            if (inst_descr[inst_id].chan_idps_aggr[ch_id]) {
+                ch->idps = kzalloc(sizeof(*ch->idps), GFP_KERNEL);
+                if (NULL == ch->idps) {
+                    free_chan_rings();
+                    return -ENOMEM;
+                }
+                spin_lock_init(&ch->idps->lock);
+            }
+            for (lane_id = 0; lane_id < ch->num_lanes; lane_id++) {
+                lane = &ch->lanes[lane_id];
+                if (IPC_OVERFLOW_LOSSLESS != lane->overflow_policy) {
+                    continue;
+                }
+                lane->held_size = get_chan_num_bufs(inst_id, ch_id);
+                lane->held = kcalloc(lane->held_size, sizeof(*lane->held), GFP_KERNEL);
+                if (NULL == lane->held) {
+                    free_chan_rings();
+                    return -ENOMEM;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ *  @brief  This function frees the descriptors and the round buffers of all
+ *          channels.
+ *  @return N/A
+ */
+static void free_chan_rings(void)
+{
+    int ch_idx = 0;
+    uint8_t lane_id;
+    struct ipc_chan_descr_t *ch;
+
+    for (ch_idx = 0; ch_idx < IPC_NUM_CHANNELS; ch_idx++) {
+        ch = ipc_ch_descr[ch_idx];
+        if (NULL == ch) {
+            continue;
+        }
+        /* The rings of all the lanes are allocated at once */
+        vfree(ch->lanes[0].ring);
+        for (lane_id = 0; lane_id < IPCF_RX_MAX_LANES; lane_id++) {
+            kfree(ch->lanes[lane_id].held);
+        }
+        /* No receive callback is registered anymore */
+        kfree(rcu_dereference_protected(ch->lane_filters, 1));
+        kfree(ch->rx_refs);
+        kfree(ch->idps);
+        kvfree(ch->frag_rx);
+        kfree(ch);
+        ipc_ch_descr[ch_idx] = NULL;
+    }
+}
+
+/**
+ *  @brief  This function initializes local variables
+ *          This function shall be called when the module is registered in order
+ *          to avoid usage of values received at a previous registration of the
+ *          device driver
+ *  @return N/A
+ */
+static void init_state_vars(void)
+{
+    int ch_idx = 0;
+    uint8_t lane_id;
+    struct ipc_chan_descr_t *ch;
+    struct ipcf_rx_ring_hdr *ring;
+    for (ch_idx = 0; ch_idx < ipcf_num_channels; ch_idx++) {
+        ch = ipc_ch_descr[ch_idx];
+        memset(ch->lanes[0].ring, 0, ch->ring_size);
+        for (lane_id = 0; lane_id < ch->num_lanes; lane_id++) {
+            ring = ch->lanes[lane_id].ring;
+            ring->version = IPCF_RX_RING_VERSION;
+            ring->num_slots = ch->lanes[lane_id].queue_depth;
+            ring->slot_size = ch->slot_size;
+            ring->slots_offset = IPC_RING_SLOTS_OFFSET;
+            ring->flags = (ch->deferred_release ? IPCF_RX_RING_F_DEFERRED : 0) |
+                          (ch->fan_out ? IPCF_RX_RING_F_FAN_OUT : 0) |
+                          ((ch->num_lanes > 1) ? IPCF_RX_RING_F_LANES : 0) |
+                          ((NULL != ch->frag_store) ? IPCF_RX_RING_F_FRAG_STORE : 0);
+            ch->lanes[lane_id].id = lane_id;
+            ch->held_head[lane_id] = 0;
+            ch->held_tail[lane_id] = 0;
+        }
+        ch->frag_store_head = 0;
+        memset(ch->frag_store_refs, 0, sizeof(ch->frag_store_refs));
+        init_waitqueue_head(&ch->rx_wait_q);
+        ch->tx_window_pool = NULL;
+        ch->tx_window_map_size = 0;
+        memset(ch->tx_window_free, 0, sizeof(ch->tx_window_free));
+        memset(ch->tx_spare, 0, sizeof(ch->tx_spare));
+        spin_lock_init(&ch->tx_lock);
+        init_waitqueue_head(&ch->tx_wait_q);
+        INIT_LIST_HEAD(&ch->subscribers);
+        INIT_DELAYED_WORK(&ch->tx_retry_work, tx_retry_work_fn);
+        ch->tx_exhausted = false;
+        spin_lock_init(&ch->consumer_lock);
+        spin_lock_init(&ch->producer_lock);
+        ch->rx_seq = 0;
+        ch->rx_lost_flags = 0;
+        atomic_set(&ch->num_readers, 0);
+        memset(&ch->stats, 0, sizeof(ch->stats));
+    }
+}
+
+/**
+ *  @brief          Gets the offset of an IPCF buffer in a shared memory area
+ *                  of the instance, as mapped in user space
+ *  @param shm_phys Physical address of the shared memory area
+ *  @param shm_size Size of the shared memory area
+ *  @param buf      IPCF buffer, may be NULL
+ *  @param size     Buffer size
+ *  @return         buffer offset, IPCF_TX_BUF_NONE if not available
+ */
+static uint32_t get_shm_offset(phys_addr_t shm_phys, uint32_t shm_size, const void *buf,
+                               uint32_t size)
+{
+    phys_addr_t buf_phys;
+
+    /* The shared memory is mapped by IPCF via ioremap */
+    if ((NULL == buf) || !is_vmalloc_or_module_addr(buf)) {
+        return IPCF_TX_BUF_NONE;
+    }
+    buf_phys = PFN_PHYS(vmalloc_to_pfn(buf)) + offset_in_page(buf);
+    if ((buf_phys < shm_phys) || ((buf_phys + size) > (shm_phys + shm_size))) {
+        return IPCF_TX_BUF_NONE;
+    }
+    return (uint32_t)(buf_phys - shm_phys);
+}
+
+/**
+ *  @brief          Gets the size of an IPCF queue in the shared memory
+ *  @param num_elem Number of elements of the queue
+ *  @param size     Element size
+ *  @return         queue size
+ */
+static uint32_t get_shm_queue_size(uint32_t num_elem, uint32_t size)
+{
+    return 2 * (IPC_SHM_RING_CTRL_SIZE + (num_elem * size));
+}
+
+/**
+ *  @brief          Gets the size of a channel in the shared memory of its
+ *                  instance, following the IPCF layout described in
+ *                  ipc-mem-cfg.h
+ *  @param cfg      Channel configuration
+ *  @return         channel size
+ */
+static uint32_t get_shm_chan_size(const struct ipc_shm_channel_cfg *cfg)
+{
+    int idx;
+    uint32_t num_bufs = 0;
+    uint32_t size = 0;
+    const struct ipc_shm_pool_cfg *pool;
+
+    if (IPC_SHM_MANAGED != cfg->type) {
+        return cfg->ch.unmanaged.size;
+    }
+    for (idx = 0; idx < cfg->ch.managed.num_pools; idx++) {
+        pool = &cfg->ch.managed.pools[idx];
+        num_bufs += pool->num_bufs;
+        size += get_shm_queue_size(pool->num_bufs, IPC_SHM_BUF_IDX_SIZE) +
+                (pool->num_bufs * pool->buf_size);
+    }
+    return get_shm_queue_size(num_bufs, IPC_SHM_BD_SIZE) + size;
+}
+
+/**
+ *  @brief          Locates the TX window of a channel in the local shared
+ *                  memory from the IPCF layout: the buffers of the pool of
+ *                  its largest buffers, after the previous channels and the
+ *                  previous pools of the channel. The window is left disabled
+ *                  if the pool does not fit in the shared memory.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         N/A
+ */
+static void init_tx_window(struct ipc_chan_descr_t *ch)
+{
+    const struct ipc_shm_cfg *cfg = &shm_cfg[ch->instance_id];
+    const struct ipc_shm_managed_cfg *mcfg = &cfg->channels[ch->channel_id].ch.managed;
+    uint64_t offset = 0;
+    uint32_t num_bufs = 0;
+    phys_addr_t pool_phys;
+    int idx;
+
+    for (idx = 0; idx < ch->channel_id; idx++) {
+        offset += get_shm_chan_size(&cfg->channels[idx]);
+    }
+    for (idx = 0; idx < mcfg->num_pools; idx++) {
+        num_bufs += mcfg->pools[idx].num_bufs;
+    }
+    offset += get_shm_queue_size(num_bufs, IPC_SHM_BD_SIZE);
+    for (idx = 0; idx < mcfg->num_pools; idx++) {
+        offset += get_shm_queue_size(mcfg->pools[idx].num_bufs, IPC_SHM_BUF_IDX_SIZE);
+        if (mcfg->pools[idx].buf_size == ch->max_buf_size) {
+            break;
+        }
+        offset += mcfg->pools[idx].num_bufs * mcfg->pools[idx].buf_size;
+    }
+    if (idx == mcfg->num_pools) {
+        return;
+    }
+    ch->tx_window_pool_size = mcfg->pools[idx].num_bufs * ch->max_buf_size;
+    if ((offset + ch->tx_window_pool_size) > cfg->shm_size) {
+        printk(KERN_WARNING "Pool of channel %s out of the shared memory, TX window disabled\n",
+               inst_descr[ch->instance_id].channel_names[ch->channel_id]);
+        return;
+    }
+    pool_phys = cfg->local_shm_addr + offset;
+    ch->tx_window_pool_offset = offset_in_page(pool_phys);
+    ch->tx_window_phys = pool_phys - ch->tx_window_pool_offset;
+    ch->tx_window_map_size = PAGE_ALIGN(ch->tx_window_pool_offset + ch->tx_window_pool_size);
+}
+
+/**
+ *  @brief          Locates the TX windows of the channels configured with
+ *                  one, at link init
+ *  @return         N/A
+ */
+static void init_tx_windows(void)
+{
+    int ch_idx;
+    struct ipc_chan_descr_t *ch;
+
+    for (ch_idx = 0; ch_idx < ipcf_num_channels; ch_idx++) {
+        ch = ipc_ch_descr[ch_idx];
+        if (0 != inst_descr[ch->instance_id].chan_tx_window_bufs[ch->channel_id]) {
+            init_tx_window(ch);
+        }
+    }
+}
+
+/**
+ *  @brief          Sets the address at which IPCF maps the TX window pool,
+ *                  from the first buffer acquired for the window. IPCF only
+ *                  exposes the physical address of the shared memory it maps
+ *                  via ioremap, the buffer address is translated once, and
+ *                  the window disabled if it is not a buffer of the pool.
+ *                  Shall be called with the TX lock held.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param buf      IPCF buffer acquired on the channel
+ *  @return         N/A
+ */
+static void map_tx_window_pool(struct ipc_chan_descr_t *ch, uint8_t *buf)
+{
+    phys_addr_t pool_phys = ch->tx_window_phys + ch->tx_window_pool_offset;
+    phys_addr_t buf_phys;
+
+    if (!is_vmalloc_or_module_addr(buf)) {
+        WRITE_ONCE(ch->tx_window_map_size, 0);
+        return;
+    }
+    buf_phys = PFN_PHYS(vmalloc_to_pfn(buf)) + offset_in_page(buf);
+    if ((buf_phys < pool_phys) ||
+        ((buf_phys + ch->max_buf_size) > (pool_phys + ch->tx_window_pool_size)) ||
+        (0 != ((buf_phys - pool_phys) % ch->max_buf_size))) {
+        printk(KERN_WARNING "Unexpected pool layout, TX window of channel %s disabled\n",
+               inst_descr[ch->instance_id].channel_names[ch->channel_id]);
+        WRITE_ONCE(ch->tx_window_map_size, 0);
+        return;
+    }
+    /* Pairs with the acquire in ipcf_mmap */
+    smp_store_release(&ch->tx_window_pool, buf - (buf_phys - pool_phys));
+}
+
+/**
+ *  @brief          Gets the offset of an IPCF buffer in the TX window mapping,
+ *                  which covers the pool of the channel.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param buf      IPCF buffer acquired on the channel, may be NULL
+ *  @return         buffer offset, IPCF_TX_BUF_NONE if not available
+ */
+static uint32_t get_tx_window_offset(struct ipc_chan_descr_t *ch, const void *buf)
+{
+    const uint8_t *pos = buf;
+    const uint8_t *pool = READ_ONCE(ch->tx_window_pool);
+
+    if ((NULL == pos) || (NULL == pool) || (pos < pool) ||
+        ((pos + ch->max_buf_size) > (pool + ch->tx_window_pool_size))) {
+        return IPCF_TX_BUF_NONE;
+    }
+    return ch->tx_window_pool_offset + (uint32_t)(pos - pool);
+}
+
+/**
+ *  @brief          Gets a buffer of the TX window pool, from the buffers left
+ *                  by the closed files first. Buffers acquired from another
+ *                  pool are kept as spare TX buffers, IPCF offering no way
+ *                  to give them back.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @return         pointer to the buffer, NULL if none is available
+ */
+static void *acquire_tx_window_buf(struct ipc_chan_descr_t *ch)
+{
+    void *buf = NULL;
+    unsigned long flags;
+    uint32_t idx;
+
+    spin_lock_irqsave(&ch->tx_lock, flags);
+    for (idx = 0; idx < IPCF_TX_WINDOW_MAX_BUFS; idx++) {
+        if (NULL != ch->tx_window_free[idx]) {
+            buf = ch->tx_window_free[idx];
+            ch->tx_window_free[idx] = NULL;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&ch->tx_lock, flags);
+    if (NULL != buf) {
+        return buf;
+    }
+
+    buf = ipc_shm_acquire_buf(ch->instance_id, ch->channel_id, ch->max_buf_size);
+    if (NULL == buf) {
+        atomic64_inc(&ch->stats.acquire_failures);
+        return NULL;
+    }
+    spin_lock_irqsave(&ch->tx_lock, flags);
+    if ((NULL == ch->tx_window_pool) && (0 != ch->tx_window_map_size)) {
+        map_tx_window_pool(ch, buf);
+    }
+    spin_unlock_irqrestore(&ch->tx_lock, flags);
+    if (IPCF_TX_BUF_NONE == get_tx_window_offset(ch, buf)) {
+        /* Taken from another pool of the same size, out of the mapping */
+        put_tx_spare(ch, buf, ch->max_buf_size);
+        atomic64_inc(&ch->stats.acquire_failures);
+        return NULL;
+    }
+    return buf;
+}
+
+/**
+ *  @brief          Acquires the missing IPCF buffers of the TX window of a
+ *                  file. Shall be called with the TX window lock held.
+ *  @param f        Pointer to the file descriptor
+ *  @return         N/A
+ */
+static void refill_tx_window(struct ipc_file_t *f)
+{
+    uint32_t idx;
+    uint8_t num_bufs = inst_descr[f->ch->instance_id].chan_tx_window_bufs[f->ch->channel_id];
+
+    for (idx = 0; idx < num_bufs; idx++) {
+        if (NULL == f->tx_window[idx]) {
+            f->tx_window[idx] = acquire_tx_window_buf(f->ch);
+        }
+    }
+}
+
+/**
+ *  @brief          Hands the IPCF buffers of the TX window of a file being
+ *                  closed back to the channel, for the next files using the
+ *                  window, then to the spare TX buffers
+ *  @param f        Pointer to the file descriptor
+ *  @return         N/A
+ */
+static void release_tx_window(struct ipc_file_t *f)
+{
+    struct ipc_chan_descr_t *ch = f->ch;
+    unsigned long flags;
+    uint32_t idx;
+    uint32_t free_idx = 0;
+
+    for (idx = 0; idx < IPCF_TX_WINDOW_MAX_BUFS; idx++) {
+        if (NULL == f->tx_window[idx]) {
+            continue;
+        }
+        spin_lock_irqsave(&ch->tx_lock, flags);
+        while ((free_idx < IPCF_TX_WINDOW_MAX_BUFS) && (NULL != ch->tx_window_free[free_idx])) {
+            free_idx++;
+        }
+        if (free_idx < IPCF_TX_WINDOW_MAX_BUFS) {
+            ch->tx_window_free[free_idx] = f->tx_window[idx];
+            f->tx_window[idx] = NULL;
+        }
+        spin_unlock_irqrestore(&ch->tx_lock, flags);
+        if (NULL != f->tx_window[idx]) {
+            put_tx_spare(ch, f->tx_window[idx], ch->max_buf_size);
+            f->tx_window[idx] = NULL;
+        }
+    }
+}
+
+/**
+ *  @brief          Sends the TX window buffers of a file described by a
+ *                  submission. Each sent buffer is replaced by a newly
+ *                  acquired one, whose offset is stored in the descriptor. The
+ *                  submission stops at the first buffer which could not be
+ *                  sent.
+ *  @param f        Pointer to the file descriptor
+ *  @param usubmit  User space pointer to the submission
+ *  @return         0 if all buffers were sent, -EFAULT/-EINVAL/-ENOBUFS or the
+ *                  IPCF error code otherwise
+ */
+static long submit_tx_window(struct ipc_file_t *f,
+                             struct ipcf_tx_submit __user *usubmit)
+{
+    long err = 0;
+    struct ipc_chan_descr_t *ch = f->ch;
+    struct ipcf_tx_submit submit;
+    struct ipcf_tx_desc desc;
+    struct ipcf_tx_desc __user *udescs;
+    uint8_t num_bufs = inst_descr[ch->instance_id].chan_tx_window_bufs[ch->channel_id];
+    uint32_t i;
+
+    if (0 == READ_ONCE(ch->tx_window_map_size)) {
+        return -EINVAL;
+    }
+    if (copy_from_user(&submit, usubmit, sizeof(submit))) {
+        return -EFAULT;
+    }
+    udescs = u64_to_user_ptr(submit.descs);
+
+    mutex_lock(&f->tx_window_lock);
+    for (i = 0; i < submit.count; i++) {
+        if (copy_from_user(&desc, &udescs[i], sizeof(desc))) {
+            err = -EFAULT;
+            break;
+        }
+        if ((desc.index >= num_bufs) || (0 == desc.size) || (desc.size > ch->max_buf_size)) {
+            err = -EINVAL;
+            break;
+        }
+        /* Only the buffers acquired via this file can be sent */
+        if (NULL == f->tx_window[desc.index]) {
+            err = -ENOBUFS;
+            break;
+        }
+        trace_ipcf_tx_start(ch->instance_id, ch->channel_id, desc.size);
+        err = ipc_shm_tx(ch->instance_id, ch->channel_id, f->tx_window[desc.index],
+                         desc.size);
+        trace_ipcf_tx_end(ch->instance_id, ch->channel_id, desc.size, err);
+        if (err) {
+            atomic64_inc(&ch->stats.tx_errors);
+            break;
+        }
+        atomic64_inc(&ch->stats.tx_msgs);
+        atomic64_add(desc.size, &ch->stats.tx_bytes);
+        /* Buffer is now owned by the remote core, replace it */
+        f->tx_window[desc.index] = acquire_tx_window_buf(ch);
+        desc.offset = get_tx_window_offset(ch, f->tx_window[desc.index]);
+        if (put_user(desc.offset, &udescs[i].offset)) {
+            /* Buffer was sent, report it before failing */
+            i++;
+            err = -EFAULT;
+            break;
+        }
+    }
+    mutex_unlock(&f->tx_window_lock);
+
+    if (put_user(i, &usubmit->submitted)) {
+        return -EFAULT;
+    }
+    return err;
+}
+
+/**
+ *  @brief          Accounts a message accepted in the round buffer: updates
+ *                  the receive statistics and clears the lost message flags,
+ *                  already reported in the frame header of the message.
+ *                  Shall only be called by the producer of the round buffer.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param size     Message size
+ *  @return         N/A
+ */
+static inline void accept_rx_msg(struct ipc_chan_descr_t *ch, size_t size)
+{
+    WRITE_ONCE(ch->stats.rx_msgs, ch->stats.rx_msgs + 1);
+    WRITE_ONCE(ch->stats.rx_bytes, ch->stats.rx_bytes + size);
+    ch->rx_lost_flags = 0;
+}
+
+/**
+ *  @brief          Accounts a received message dropped by the driver, the
+ *                  next accepted message is flagged accordingly.
+ *                  Shall only be called by the producer of the round buffer.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param counter  Drop counter to increment
+ *  @return         N/A
+ */
+static inline void drop_rx_msg(struct ipc_chan_descr_t *ch, uint64_t *counter)
+{
+    WRITE_ONCE(*counter, *counter + 1);
+    ch->rx_lost_flags |= IPCF_FRAME_F_DROPPED;
+}
+
+/**
+ *  @brief          Discards the message being reassembled, if any.
+ *                  Shall only be called by the producer of the round buffer.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param counter  Drop counter to increment
+ *  @return         N/A
+ */
+static void discard_rx_frags(struct ipc_chan_descr_t *ch, uint64_t *counter)
+{
+    if (ch->frag_rx->in_progress) {
+        ch->frag_rx->in_progress = false;
+        drop_rx_msg(ch, counter);
+    }
+}
+
+/**
+ *  @brief          Adds a received fragment to the message being reassembled,
+ *                  see FRAGMENTATION in ipc-chardev.h. A fragment starting a
+ *                  message discards the previous one if incomplete, any other
+ *                  fragment shall continue the message being reassembled.
+ *                  Shall only be called by the producer of the round buffer.
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param buf      Pointer to the received IPCF buffer
+ *  @param psize    Fragment size, set to the message size once complete
+ *  @param stamp    Reception time of the fragment, in ns
+ *  @return         pointer to the reassembled message once its last fragment
+ *                  is received, NULL otherwise
+ */
+static void *reassemble_rx_frag(struct ipc_chan_descr_t *ch, const void *buf, size_t *psize,
+                                u64 stamp)
+{
+    struct ipc_frag_rx_t *frag = ch->frag_rx;
+    const struct ipcf_frag_hdr *hdr = buf;
+    uint32_t msg_size;
+    uint32_t offset;
+    uint16_t msg_seq;
+    size_t frag_len;
+
+    if (*psize < sizeof(*hdr)) {
+        drop_rx_msg(ch, &ch->stats.rx_frag_errors);
+        return NULL;
+    }
+    msg_size = le32_to_cpu(hdr->msg_size);
+    offset = le32_to_cpu(hdr->offset);
+    msg_seq = le16_to_cpu(hdr->msg_seq);
+    frag_len = *psize - sizeof(*hdr);
+    WRITE_ONCE(ch->stats.rx_frags, ch->stats.rx_frags + 1);
+
+    if (frag->in_progress && ((stamp - frag->stamp) > IPC_FRAG_TIMEOUT_NS)) {
+        discard_rx_frags(ch, &ch->stats.rx_frag_timeouts);
+    }
+    if (0 == offset) {
+        discard_rx_frags(ch, &ch->stats.rx_frag_incomplete);
+        if (msg_size > ch->max_msg_size) {
+            drop_rx_msg(ch, &ch->stats.oversize_drops);
+            return NULL;
+        }
+        frag->in_progress = true;
+        frag->msg_seq = msg_seq;
+        frag->msg_size = msg_size;
+        frag->received = 0;
+        frag->stamp = stamp;
+    } else if (!frag->in_progress || (msg_seq != frag->msg_seq) ||
+               (msg_size != frag->msg_size) || (offset != frag->received)) {
+        /* The previous fragments of this message were lost */
+        discard_rx_frags(ch, &ch->stats.rx_frag_incomplete);
+        drop_rx_msg(ch, &ch->stats.rx_frag_errors);
+        return NULL;
+    }
+    if (frag_len > (frag->msg_size - frag->received)) {
+        frag->in_progress = false;
+        drop_rx_msg(ch, &ch->stats.rx_frag_errors);
+        return NULL;
+    }
+
+    memcpy(frag->buf + frag->received, hdr + 1, frag_len);
+    frag->received += frag_len;
+    if (frag->received < frag->msg_size) {
+        return NULL;
+    }
+    frag->in_progress = false;
+    *psize = frag->msg_size;
+    return frag->buf;
+}
+
+/**
+ *  @brief          Passes a received message to the kernel subscribers of its
+ *                  channel
+ *  @param ch       Pointer to the internal channel descriptor
+ *  @param buf      Pointer to the received buffer
+ *  @param size     Message size
+ *  @return         N/A
+ */
+static void dispatch_rx_subscribers(struct ipc_chan_descr_t *ch, const void *buf, size_t size)
+{
+    struct ipcf_chdev_subscriber *sub;
+
+    rcu_read_lock();
+    list_for_each_entry_rcu(sub, &ch->subscribers, node) {
+        sub->rx_cb(sub->cb_arg, ch->instance_id, ch->channel_id, buf, size);
+    }
+    rcu_read_unlock();
+}
+
+/**
+ *  @brief          Counts a message id in the IDPS message id table, using the
+ *                  space-saving algorithm
+ *  @param stats    Pointer to the IDPS counters
+ *  @param id       Message id
+ *  @return         N/A
+ */
+static void count_idps_msg_id(struct ipcf_idps_stats *stats, uint32_t id)
+{
+    uint32_t i;
+    uint32_t min_idx = 0;
+
+    for (i = 0; i < stats->top_count; i++) {
+        if (stats->top[i].message_id == id) {
+            stats->top[i].count++;
+            return;
+        }
+        if (stats->top[i].count < stats->top[min_idx].count) {
+            min_idx = i;
+        }
+    }
+    if (stats->top_count < IPCF_IDPS_TOP_N) {
+        stats->top[stats->top_count].message_id = id;
+        stats->top[stats->top_count].count = 1;
+        stats->top[stats->top_count].error = 0;
+        stats->top_count++;
+        return;
+    }
+    /* Replace the least frequent id, its count bounding the occurrences of
+       the new id missed so far */
+    stats->top[min_idx].message_id = id;
+    stats->top[min_idx].error = stats->top[min_idx].count;
+    stats->top[min_idx].count++;
+}
+
+/**
+ *  @brief          Decodes a received message as an IDPS record and updates
+ *                  the IDPS counters of the channel
+ *  @param ch       Pointer to the channel descriptor
+ *  @param buf      Pointer to the received message
+ *  @param size     Message size
+ *  @return         N/A
+ */
+static void aggregate_idps_record(struct ipc_chan_descr_t *ch, const void *buf, size_t size)
+{
+    const struct ipcf_idps_record *rec = buf;
+    struct ipcf_idps_stats *stats = &ch->idps->stats;
+    unsigned long flags;
+    uint32_t bus_id;
+    uint32_t tag;
+
+    spin_lock_irqsave(&ch->idps->lock, flags);
+    if (size < IPCF_IDPS_RECORD_SIZE) {
+        stats->malformed++;
+        spin_unlock_irqrestore(&ch->idps->lock, flags);
+        return;
+    }
+    stats->records++;
+    if (rec->engine_id < IPCF_IDPS_MAX_ENGINES) {
+        stats->engines[rec->engine_id]++;
+    } else {
+        stats->engines_other++;
+    }
+    bus_id = get_unaligned_le32(&rec->bus_id);
+    if (bus_id < IPCF_IDPS_MAX_BUSES) {
+        stats->buses[bus_id]++;
+    } else {
+        stats->buses_other++;
+    }
+    tag = get_unaligned_le32(&rec->detection_tag);
+    if (tag < IPCF_IDPS_MAX_TAGS) {
+        stats->tags[tag]++;
+    } else {
+        stats->tags_other++;
+    }
+    stats->last_timestamp = get_unaligned_le32(&rec->timestamp);
+    count_idps_msg_id(stats, get_unaligned_le32(&rec->message_id));
+    spin_unlock_irqrestore(&ch->idps->lock, flags);
+}
+
+/**
+ *  @brief          Compares two entries of the IDPS message id table, for a
+ *                  sort by decreasing count
+ *  @param a        Pointer to the first entry
+ *  @param b        Pointer to the second entry
+ *  @return         negative if a sorts first, positive if b sorts first, 0
+ *                  if equal
+ */
+static int cmp_idps_msg_count(const void *a, const void *b)
+{
+    const struct ipcf_idps_msg_count *ma = a;
+    const struct ipcf_idps_msg_count *mb = b;
+
+    if (ma->count == mb->count) {
+        return 0;
+    }
+    return (ma->count > mb->count) ? -1 : 1;
+}
+
+/**
+ *  @brief          Returns the IDPS counters of a channel to user space
+ *  @param ch       Pointer to the channel descriptor
+ *  @param ustats   User space pointer to the returned counters
+ *  @param reset    Reset the counters once read
+ *  @return         0 on success, -EINVAL if the channel has no IDPS
+ *                  aggregator, -ENOMEM, -EFAULT
+ */
+static long get_idps_stats(struct ipc_chan_descr_t *ch, struct ipcf_idps_stats __user *ustats,
+                           bool reset)
+{
+    struct ipcf_idps_stats *stats;
+    unsigned long flags;
+    long err = 0;
+
+    if (NULL == ch->idps) {
+        return -EINVAL;
+    }
+    stats = kmalloc(sizeof(*stats), GFP_KERNEL);
+    if (NULL == stats) {
+        return -ENOMEM;
+    }
+    spin_lock_irqsave(&ch->idps->lock, flags);
+    memcpy(stats, &ch->idps->stats, sizeof(*stats));
+    if (reset) {
+        memset(&ch->idps->stats, 0, sizeof(ch->idps->stats));
+    }
+    spin_unlock_irqrestore(&ch->idps->lock, flags);
+
+    sort(stats->top, stats->top_count, sizeof(stats->top[0]), cmp_idps_msg_count, NULL);
+    if (copy_to_user(ustats, stats, sizeof(*stats))) {
+        err = -EFAULT;
+    }
+    kfree(stats);
+    return err;
+}
+
+/**
+ *  @brief          Wakes the readers of a channel after a received message.
+ *                  On polled instances, the readers are woken once per poll.
+ *  @param ch       Pointer to the channel descriptor
+ *  @return         N/A
+ */
+static void signal_rx_readers(struct ipc_chan_descr_t *ch)
+{
+    if (ch->rx_polled) {
+        ch->rx_wake_pending = true;
+        return;
+    }
+    wake_up_interruptible_poll(&ch->rx_wait_q, get_rx_poll_events(ch));
+}
+
+/**
+ *  @brief          Timer function of the polled RX mode, drains the channels
+ *                  of an instance, then wakes their readers. Runs in softirq
+ *                  context, as the IPCF receive softirq.
+ *  @param timer    Poll timer of the instance
+ *  @return         HRTIMER_RESTART
+ */
+static enum hrtimer_restart rx_poll_timer_fn(struct hrtimer *timer)
+{
+    struct ipc_inst_poll_t *poll = container_of(timer, struct ipc_inst_poll_t, timer);
+    uint32_t total = 0;
+    int num;
+    int i;
+
+    do {
+        num = ipc_shm_poll_channels(poll->instance_id);
+        if (num > 0) {
+            total += num;
+        }
+    } while ((num > 0) && (total < IPC_RX_POLL_BUDGET));
+
+    if (num < 0) {
+        printk_ratelimited(KERN_ALERT "Failed to poll instance %d, err code %d \n",
+                           poll->instance_id, num);
+    }
+    atomic64_inc(&poll->polls);
+
+    if (0 == total) {
+        poll->backoff = min_t(uint32_t, 2 * poll->backoff, IPC_RX_POLL_MAX_BACKOFF);
+    } else {
+        atomic64_add(total, &poll->msgs);
+        poll->backoff = 1;
+        for (i = 0; i < ipcf_num_channels; i++) {
+            if ((ipc_ch_descr[i]->instance_id == poll->instance_id) &&
+                ipc_ch_descr[i]->rx_wake_pending) {
+                ipc_ch_descr[i]->rx_wake_pending = false;
+                wake_up_interruptible_poll(&ipc_ch_descr[i]->rx_wait_q,
+                                           get_rx_poll_events(ipc_ch_descr[i]));
+            }
+        }
+    }
+
+    hrtimer_forward_now(timer, ktime_mul(poll->period, poll->backoff));
+    return HRTIMER_RESTART;
+}
+
+/**
+ *  @brief          Moves the RX path of the instance of a channel to the CPU of
+ *                  the calling reader, on instances using IPC_RX_CPU_READER,
+ *                  so that the round buffer is written where it is read
+ *  @param ch       Pointer to the channel descriptor
+ *  @return         N/A
+ */
+static void steer_rx_to_reader(struct ipc_chan_descr_t *ch)
+{
+    struct ipc_inst_affinity_t *aff = &ipc_inst_affinity[ch->instance_id];
+    int cpu;
+
+    if (IPC_RX_CPU_READER != aff->policy) {
+        return;
+    }
+    cpu = raw_smp_processor_id();
+    if (READ_ONCE(aff->target) == cpu) {
+        return;
+    }
+    WRITE_ONCE(aff->target, cpu);
+    /* If the work is already pending on the previous CPU, it moves itself
+       to the new target */
+    queue_work_on(cpu, system_highpri_wq, &aff->work);
+}
+
+/**
+ *  @brief          Moves the RX interrupt and the poll timer of an instance to
+ *                  the CPU selected by its affinity policy, requeuing itself
+ *                  on this CPU if needed. The CPU handling the RX path is only
+ *                  updated once moved.
+ *  @param work     Affinity work of the instance
+ *  @return         N/A
+ */
+static void rx_affinity_work_fn(struct work_struct *work)
+{
+    struct ipc_inst_affinity_t *aff = container_of(work, struct ipc_inst_affinity_t, work);
+    struct ipc_inst_poll_t *poll = &ipc_inst_poll[aff - ipc_inst_affinity];
+    int cpu = READ_ONCE(aff->target);
+    int err;
+
+    if (READ_ONCE(aff->stopping) || (cpu < 0) || (READ_ONCE(aff->cpu) == cpu) ||
+        !cpu_online(cpu)) {
+        return;
+    }
+    /* The target changed while the work was pending on another CPU */
+    if (raw_smp_processor_id() != cpu) {
+        queue_work_on(cpu, system_highpri_wq, &aff->work);
+        return;
+    }
+    if (aff->irq > 0) {
+        err = irq_set_affinity(aff->irq, cpumask_of(cpu));
+        if (err) {
+            printk_ratelimited(KERN_WARNING "Failed to set the affinity of irq %d to "
+                               "CPU %d, err code %d\n", aff->irq, cpu, err);
+            return;
+        }
+    }
+    /* Restarted from this CPU, the poll timer is pinned to it */
+    if (0 != ktime_to_ns(poll->period)) {
+        hrtimer_cancel(&poll->timer);
+        hrtimer_start(&poll->timer, poll->period, HRTIMER_MODE_REL_PINNED_SOFT);
+    }
+    WRITE_ONCE(aff->cpu, cpu);
+}
+
+/**
+ *  @brief          Callback function for the received messages.
+ *
+ *  @param arg      Callback argument, the internal channel descriptor
+ *  @param inst_id  The instance for which the callback is called
+ *  @param chan_id  Channel unique identifier for which the callback is called
+ *  @param buf      Pointer to the received buffer
+ *  @param instance The instance for which the callback is called
+ *
+ *  @return         N/A
+ */
+static void data_chan_rx_cb(void *arg, const uint8_t inst_id, int chan_id,
+                            void *buf, size_t size)
+{
+    int err;
+    unsigned long flags;
+    struct ipc_chan_descr_t *ch = arg;
+    struct ipc_lane_t *lane;
+    struct ipc_held_buf_t *held;
+    void *ipc_buf = buf;
+    struct ipc_rx_meta_t meta = {
+        .stamp = ktime_get_ns(),
+    };
+
+    if (NULL == ch) {
+        printk_ratelimited(KERN_ALERT "IPCF callback called for unknown device via \
+               instance id: %d and channel %d \n", inst_id, chan_id);
+        goto free_ipc_buffer;
+    }
+    if (NULL != ch->frag_rx) {
+        /* The message goes on from the reassembly buffer once complete, the
+           IPCF buffer of the fragment is released in any case */
+        buf = reassemble_rx_frag(ch, ipc_buf, &size, meta.stamp);
+        if (NULL == buf) {
+            goto free_ipc_buffer;
+        }
+    }
+    meta.seq = ch->rx_seq++;
+    meta.flags = ch->rx_lost_flags;
+    lane = select_rx_lane(ch, buf, size);
+
+    trace_ipcf_rx_cb(inst_id, chan_id, size, READ_ONCE(lane->ring->producer));
+    dispatch_rx_subscribers(ch, buf, size);
+    if (NULL != ch->idps) {
+        aggregate_idps_record(ch, buf, size);
+    }
+
+    if (ch->max_msg_size < size) {
+        printk_ratelimited(KERN_ALERT "Received data does not fit \
+               in the existing buffers with for instance id %d, channel id %d,\
+               of size %zu \n", inst_id, chan_id, size);
+        drop_rx_msg(ch, &ch->stats.oversize_drops);
+        goto free_ipc_buffer;
+    }
+
+    if (ch->deferred_release) {
+        if (is_ring_full(lane)) {
+            drop_rx_msg(ch, &ch->stats.ring_drops);
+            goto free_ipc_buffer;
+        }
+        /* Buffer is released once consumed */
+        push_rx_ref(ch, buf, size, &meta);
+        accept_rx_msg(ch, size);
+        signal_rx_readers(ch);
+        return;
+    }
+
+    /* Messages larger than a slot go to the fragmentation store */
+    if ((size > get_slot_capacity(ch)) && is_frag_store_busy(ch)) {
+        drop_rx_msg(ch, &ch->stats.ring_drops);
+        goto free_ipc_buffer;
+    }
+
+    switch (lane->overflow_policy) {
+    case IPC_OVERFLOW_LOSSLESS:
+        spin_lock_irqsave(&ch->producer_lock, flags);
+        /* Keep the order of the messages of the lane, once a buffer is held
+           all the following ones are held as well, until the readers catch
+           up */
+        if ((ch->held_head[lane->id] != ch->held_tail[lane->id]) || is_ring_full(lane)) {
+            if ((ch->held_head[lane->id] - ch->held_tail[lane->id]) < lane->held_size) {
+                held = &lane->held[ch->held_head[lane->id] % lane->held_size];
+                held->buf = buf;
+                held->size = size;
+                held->meta = meta;
+                ch->held_head[lane->id]++;
+                accept_rx_msg(ch, size);
+                spin_unlock_irqrestore(&ch->producer_lock, flags);
+                /* Buffer is released once moved to the round buffer */
+                return;
+            }
+            drop_rx_msg(ch, &ch->stats.ring_drops);
+            spin_unlock_irqrestore(&ch->producer_lock, flags);
+            goto free_ipc_buffer;
+        }
+        push_rx_msg(ch, lane, buf, size, &meta);
+        accept_rx_msg(ch, size);
+        spin_unlock_irqrestore(&ch->producer_lock, flags);
+        break;
+    case IPC_OVERFLOW_DROP:
+        if (is_ring_full(lane)) {
+            drop_rx_msg(ch, &ch->stats.ring_drops);
+            goto free_ipc_buffer;
+        }
+        push_rx_msg(ch, lane, buf, size, &meta);
+        accept_rx_msg(ch, size);
+        break;
+    default:
+        /* The readers of fan-out channels account their own overruns */
+        if (!ch->fan_out && is_ring_full(lane)) {
+            WRITE_ONCE(ch->stats.ring_overwrites, ch->stats.ring_overwrites + 1);
+        }
+        push_rx_msg(ch, lane, buf, size, &meta);
+        accept_rx_msg(ch, size);
+        break;
+    }
+
+    /* Wake up readers waiting for data on this channel */
+    signal_rx_readers(ch);
+
+free_ipc_buffer:
+    /* release the buffer */
+    err = ipc_shm_release_buf(inst_id, chan_id, ipc_buf);
+    if (err) {
+        printk_ratelimited(KERN_ALERT "failed to free buffer for instance %d, channel %d,"
+                           "err code %d \n", inst_id, chan_id, err);
+    }
+}
+
+/**
+ *  @brief          Fills the extended frame header of a claimed message
+ *  @param hdr      Pointer to the frame header
+ *  @param msg      Pointer to the claimed message
+ *  @param flags    Additional frame flags, IPCF_FRAME_F_*
+ *  @return         N/A
+ */
+static void fill_frame_hdr(struct ipcf_frame_hdr *hdr, const struct ipc_ring_msg_t *msg,
+                           uint16_t flags)
+{
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->version = IPCF_FRAME_HDR_VERSION;
+    hdr->hdr_size = sizeof(*hdr);
+    hdr->flags = msg->meta.flags | flags;
+    hdr->size = msg->size;
+    hdr->timestamp = msg->meta.stamp;
+    hdr->seq = msg->meta.seq;
+}
+
+/* ==========================================================================
+ *                              GLOBAL FUNCTIONS
+ * ==========================================================================*/
+/**
+ *  @brief          Read function for Ipc character device driver.
+ *                  This function is called whenever the character device driver
+ *                  is open for reading, e.g: a "cat" operation, via read or
+ *                  readv, the user buffers being filled in order.
+ *                  It reads from the message queue and returns the first
+ *                  unprocessed message to the user space, preceded by its
+ *                  size or its extended frame header if configured so. On
+ *                  channels with batched reads enabled, as many complete
+ *                  messages as fit in the user buffers are returned, each one
+ *                  preceded by its size or frame header.
+ *                  A message is never split, it stays in the queue if it does
+ *                  not fit in the remaining space of the user buffers.
+ *                  If no message is pending, the caller is put to sleep until
+ *                  the receive callback queues one, unless the file was opened
+ *                  with O_NONBLOCK, in which case -EAGAIN is returned.
+ *  @param iocb     I/O control block of the device driver file
+ *  @param to       User buffers
+ *
+ *  @return         size of read data, -EINVAL if the first pending message
+ *                  does not fit in the user buffers, -EAGAIN/-ERESTARTSYS/-EFAULT
+ *                  on other errors
+ */
+ssize_t ipcf_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    int err;
+    ssize_t ret = 0;
+    struct file *pfile = iocb->ki_filp;
+    struct ipc_file_t *f = pfile->private_data;
+    struct ipc_chan_descr_t *ch = f->ch;
+    uint8_t inst_id = ch->instance_id;
+    uint8_t chan_id = ch->channel_id;
+    size_t length = iov_iter_count(to);
+    bool nonblock = (pfile->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT);
+    bool frame_hdr = inst_descr[inst_id].chan_frame_hdr[chan_id];
+    bool prepend_size = inst_descr[inst_id].chan_prepend_size[chan_id];
+    size_t hdr_size = frame_hdr ? sizeof(struct ipcf_frame_hdr) :
+                      (prepend_size ? IPC_MSG_SIZE_LEN : 0);
+    bool batch_read = (0 != hdr_size) && inst_descr[inst_id].chan_batch_read[chan_id];
+    uint32_t pbuff_size_be;
+    struct ipcf_frame_hdr hdr;
+    void *phdr = frame_hdr ? (void *)&hdr : (void *)&pbuff_size_be;
+    uint16_t lost_flags = 0;
+    size_t copied;
+    struct ipc_ring_msg_t msg;
+
+    atomic64_inc(&ch->stats.read_calls);
+    steer_rx_to_reader(ch);
+
+    if (length < hdr_size) {
+        return -EINVAL;
+    }
+
+    while (0 == ret) {
+        while (0 == get_file_pending_msg(f)) {
+            if (nonblock) {
+                return -EAGAIN;
+            }
+            if (wait_event_interruptible(ch->rx_wait_q,
+                                         0 != get_file_pending_msg(f))) {
+                return -ERESTARTSYS;
+            }
+        }
+
+        /* Messages are claimed and released by one reader of the file at a
+           time */
+        if (nonblock) {
+            if (!mutex_trylock(&f->read_lock)) {
+                return -EAGAIN;
+            }
+        } else if (mutex_lock_interruptible(&f->read_lock)) {
+            return -ERESTARTSYS;
+        }
+        do {
+            /* Never split a message, keep it for the next read instead */
+            err = claim_pending_buff(f, length - ret - hdr_size, &msg);
+            if (-ENODATA == err) {
+                break;
+            }
+            /* Messages filtered out are consumed without copy, whatever
+               their size */
+            if (((0 == err) || (-EMSGSIZE == err)) && !match_file_filter(f, &msg)) {
+                release_pending_buff(f, &msg);
+                atomic64_inc(&ch->stats.rx_filtered);
+                continue;
+            }
+            if (err) {
+                ret = (0 == ret) ? -EINVAL : ret;
+                goto unlock;
+            }
+            if (frame_hdr) {
+                fill_frame_hdr(&hdr, &msg, lost_flags);
+            } else {
+                pbuff_size_be = cpu_to_be32(msg.size);
+            }
+            /* Copy header and payload to user space */
+            copied = copy_to_iter(phdr, hdr_size, to);
+            if (copied == hdr_size) {
+                copied += copy_to_iter(msg.buf, min_t(uint32_t, msg.size, ch->max_msg_size),
+                                       to);
+            }
+            if (copied != (hdr_size + msg.size)) {
+                printk_ratelimited(KERN_ALERT "failed to copy message to user space \n");
+                iov_iter_revert(to, copied);
+                abort_pending_buff(ch, &msg);
+                ret = (0 == ret) ? -EFAULT : ret;
+                goto unlock;
+            }
+            /* Discard the copied data if the message was overwritten meanwhile,
+               the next message takes its place in the user buffers */
+            if (release_pending_buff(f, &msg)) {
+                trace_ipcf_read(inst_id, chan_id, msg.size, msg.idx);
+                ret += hdr_size + msg.size;
+                lost_flags = 0;
+            } else {
+                iov_iter_revert(to, copied);
+                lost_flags |= IPCF_FRAME_F_OVERWRITTEN;
+            }
+        } while (batch_read && ((length - ret) >= hdr_size));
+        mutex_unlock(&f->read_lock);
+    }
+
+    return ret;
+
+unlock:
+    mutex_unlock(&f->read_lock);
+    return ret;
+}
+
+/**
+* @brief  Wakes the writers waiting for a TX buffer, so that they try
+*         acquiring one again
+*
+* @param  work      tx_retry_work of the channel
+*
+* @return N/A
+*/
+static void tx_retry_work_fn(struct work_struct *work)
+{
+    struct ipc_chan_descr_t *ch = container_of(to_delayed_work(work),
+                                               struct ipc_chan_descr_t, tx_retry_work);
+
+    /* The remote core may have released buffers in the meantime */
+    WRITE_ONCE(ch->tx_exhausted, false);
+    wake_up_interruptible_poll(&ch->tx_wait_q, EPOLLOUT | EPOLLWRNORM);
+}
+
+/**
+* @brief  Takes a spare TX buffer of a channel
+*
+* @param  ch        Pointer to the internal channel descriptor
+* @param  length    Message size
+*
+* @return pointer to the buffer, NULL if no spare buffer fits the message
+*/
+static void *take_tx_spare(struct ipc_chan_descr_t *ch, size_t length)
+{
+    int idx;
+    unsigned long flags;
+    void *buf = NULL;
+
+    spin_lock_irqsave(&ch->tx_lock, flags);
+    for (idx = 0; idx < IPC_TX_SPARE_BUFS; idx++) {
+        if ((NULL != ch->tx_spare[idx].buf) && (length <= ch->tx_spare[idx].size)) {
+            buf = ch->tx_spare[idx].buf;
+            ch->tx_spare[idx].buf = NULL;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&ch->tx_lock, flags);
+    return buf;
+}
+
+/**
+* @brief  Keeps an acquired TX buffer which was not sent for a later write.
+*         IPCF offers no way to give it back, if all spare slots are in use
+*         the smallest buffer is lost.
+*
+* @param  ch        Pointer to the internal channel descriptor
+* @param  buf       Pointer to the buffer
+* @param  size      Minimum buffer size
+*
+* @return N/A
+*/
+static void put_tx_spare(struct ipc_chan_descr_t *ch, void *buf, uint32_t size)
+{
+    int idx;
+    unsigned long flags;
+    int victim = 0;
+
+    spin_lock_irqsave(&ch->tx_lock, flags);
+    for (idx = 0; idx < IPC_TX_SPARE_BUFS; idx++) {
+        if (NULL == ch->tx_spare[idx].buf) {
+            victim = idx;
+            break;
+        }
+        if (ch->tx_spare[idx].size < ch->tx_spare[victim].size) {
+            victim = idx;
+        }
+    }
+    if ((NULL == ch->tx_spare[victim].buf) || (ch->tx_spare[victim].size < size)) {
+        if (NULL != ch->tx_spare[victim].buf) {
+            atomic64_inc(&ch->stats.tx_buf_leaks);
+        }
+        ch->tx_spare[victim].buf = buf;
+        ch->tx_spare[victim].size = size;
+    } else {
+        atomic64_inc(&ch->stats.tx_buf_leaks);
+    }
+    spin_unlock_irqrestore(&ch->tx_lock, flags);
+}
+
+/**
+* @brief  Tries to get a TX buffer, from the spare ones first. If none is
+*         available, a new attempt is scheduled for the waiting writers.
+*
+* @param  ch        Pointer to the internal channel descriptor
+* @param  length    Message size
+*
+* @return pointer to the buffer, NULL if the pools are exhausted
+*/
+static void *try_get_tx_buf(struct ipc_chan_descr_t *ch, size_t length)
+{
+    void *buf = take_tx_spare(ch, length);
+
+    if (NULL == buf) {
+        buf = ipc_shm_acquire_buf(ch->instance_id, ch->channel_id, length);
+        WRITE_ONCE(ch->tx_exhausted, NULL == buf);
+    }
+    if (NULL == buf) {
+        schedule_delayed_work(&ch->tx_retry_work, IPC_TX_RETRY_INTERVAL);
+    }
+    return buf;
+}
+
+/**
+* @brief  Gets a TX buffer, waiting up to tx_timeout_ms for one to be freed
+*         by the remote core unless nonblock is set
+*
+* @param  ch        Pointer to the internal channel descriptor
+* @param  length    Message size
+* @param  nonblock  Do not wait for a buffer
+* @param  pbuf      Pointer to the returned buffer
+*
+* @return 0 on success, -EAGAIN/-ETIMEDOUT/-ERESTARTSYS otherwise
+*/
+static int get_tx_buf(struct ipc_chan_descr_t *ch, size_t length, bool nonblock,
+                      void **pbuf)
+{
+    long ret;
+
+    *pbuf = try_get_tx_buf(ch, length);
+    if (NULL != *pbuf) {
+        return 0;
+    }
+    atomic64_inc(&ch->stats.acquire_failures);
+    if (nonblock) {
+        return -EAGAIN;
+    }
+
+    atomic64_inc(&ch->stats.tx_waits);
+    ret = wait_event_interruptible_timeout(ch->tx_wait_q,
+                                           NULL != (*pbuf = try_get_tx_buf(ch, length)),
+                                           msecs_to_jiffies(READ_ONCE(tx_timeout_ms)));
+    if (0 == ret) {
+        atomic64_inc(&ch->stats.tx_timeouts);
+        return -ETIMEDOUT;
+    }
+    return (ret < 0) ? (int)ret : 0;
+}
+
+/**
+* @brief  Checks whether a write is expected to find a TX buffer: a spare one
+*         is kept, or the last acquisition did not fail. No buffer is
+*         acquired, the pools are only used by the write path.
+*
+* @param  ch        Pointer to the internal channel descriptor
+*
+* @return true if a TX buffer is expected to be available
+*/
+static bool is_tx_ready(struct ipc_chan_descr_t *ch)
+{
+    int idx;
+    unsigned long flags;
+    bool ready = !READ_ONCE(ch->tx_exhausted);
+
+    if (ready) {
+        return true;
+    }
+    spin_lock_irqsave(&ch->tx_lock, flags);
+    for (idx = 0; idx < IPC_TX_SPARE_BUFS; idx++) {
+        ready = ready || (NULL != ch->tx_spare[idx].buf);
+    }
+    spin_unlock_irqrestore(&ch->tx_lock, flags);
+    return ready;
+}
+
+/**
+* @brief  Sends a message read from the user buffers. A buffer which could
+*         not be sent is kept for the next writes.
+*
+* @param  ch        Pointer to the internal channel descriptor
+* @param  from      User buffers, advanced past the message
+* @param  length    Message size
+* @param  nonblock  Do not wait for a TX buffer
+*
+* @return 0 on success, -EAGAIN/-ETIMEDOUT/-ERESTARTSYS/-EFAULT or the IPCF
+*         error code otherwise
+*/
+static int send_msg_iter(struct ipc_chan_descr_t *ch, struct iov_iter *from, size_t length,
+                         bool nonblock)
+{
+    int err;
+    void *buf = NULL;
+    uint8_t inst_id = ch->instance_id;
+    uint8_t chan_id = ch->channel_id;
+
+    err = get_tx_buf(ch, length, nonblock, &buf);
+    if (err) {
+        return err;
+    }
+
+    /* copy the buffer from user to ipc engine */
+    if (copy_from_iter(buf, length, from) != length) {
+        atomic64_inc(&ch->stats.tx_copy_faults);
+        put_tx_spare(ch, buf, length);
+        return -EFAULT;
+    }
+
+    trace_ipcf_tx_start(inst_id, chan_id, length);
+    err = ipc_shm_tx(inst_id, chan_id, buf, length);
+    trace_ipcf_tx_end(inst_id, chan_id, length, err);
+    if (err) {
+        printk_ratelimited(KERN_ALERT "tx failed for instance ID %d channel ID %d, "
+                           "size %d, error code %d\n", inst_id, chan_id, (int)length, err);
+        atomic64_inc(&ch->stats.tx_errors);
+        put_tx_spare(ch, buf, length);
+        return err;
+    }
+    atomic64_inc(&ch->stats.tx_msgs);
+    atomic64_add(length, &ch->stats.tx_bytes);
+    return 0;
+}
+
+/**
+* @brief  Sends a message as fragments, each one preceded by a fragment
+*         header, see FRAGMENTATION in ipc-chardev.h. The fragments of a
+*         message are sent by one sender at a time. Once a fragment was sent,
+*         a failure aborts the message, which the remote core discards as
+*         incomplete.
+*
+* @param  ch        Pointer to the internal channel descriptor
+* @param  from      Message buffers, advanced past the sent fragments
+* @param  length    Message size
+* @param  nonblock  Wait neither for another sender nor for a TX buffer
+*
+* @return 0 on success, -EAGAIN/-ETIMEDOUT/-ERESTARTSYS/-EFAULT or the IPCF
+*         error code otherwise
+*/
+static int send_frag_msg_iter(struct ipc_chan_descr_t *ch, struct iov_iter *from,
+                              size_t length, bool nonblock)
+{
+    int err = 0;
+    long ret;
+    void *buf = NULL;
+    struct ipcf_frag_hdr *hdr;
+    size_t offset = 0;
+    size_t frag_len;
+    uint8_t inst_id = ch->instance_id;
+    uint8_t chan_id = ch->channel_id;
+
+    if (test_and_set_bit_lock(0, &ch->tx_frag_busy)) {
+        if (nonblock) {
+            return -EAGAIN;
+        }
+        ret = wait_event_interruptible_timeout(ch->tx_wait_q,
+                                               !test_and_set_bit_lock(0, &ch->tx_frag_busy),
+                                               msecs_to_jiffies(READ_ONCE(tx_timeout_ms)));
+        if (0 == ret) {
+            atomic64_inc(&ch->stats.tx_timeouts);
+            return -ETIMEDOUT;
+        }
+        if (ret < 0) {
+            return (int)ret;
+        }
+    }
+
+    do {
+        frag_len = min_t(size_t, length - offset, ch->max_buf_size - sizeof(*hdr));
+        err = get_tx_buf(ch, sizeof(*hdr) + frag_len, nonblock, &buf);
+        if (err) {
+            break;
+        }
+        hdr = buf;
+        hdr->msg_size = cpu_to_le32(length);
+        hdr->offset = cpu_to_le32(offset);
+        hdr->msg_seq = cpu_to_le16(ch->tx_frag_seq);
+        hdr->reserved = 0;
+        if (copy_from_iter(hdr + 1, frag_len, from) != frag_len) {
+            atomic64_inc(&ch->stats.tx_copy_faults);
+            put_tx_spare(ch, buf, sizeof(*hdr) + frag_len);
+            err = -EFAULT;
+            break;
+        }
+
+        trace_ipcf_tx_start(inst_id, chan_id, sizeof(*hdr) + frag_len);
+        err = ipc_shm_tx(inst_id, chan_id, buf, sizeof(*hdr) + frag_len);
+        trace_ipcf_tx_end(inst_id, chan_id, sizeof(*hdr) + frag_len, err);
+        if (err) {
+            printk_ratelimited(KERN_ALERT "tx failed for instance ID %d channel ID %d, "
+                               "fragment at %zu of %zu, error code %d\n", inst_id, chan_id,
+                               offset, length, err);
+            atomic64_inc(&ch->stats.tx_errors);
+            put_tx_spare(ch, buf, sizeof(*hdr) + frag_len);
+            break;
+        }
+        atomic64_inc(&ch->stats.tx_frags);
+        offset += frag_len;
+    } while (offset < length);
+
+    /* An aborted message is not continued, the next one has its own number */
+    ch->tx_frag_seq++;
+    clear_bit_unlock(0, &ch->tx_frag_busy);
+    wake_up_interruptible_poll(&ch->tx_wait_q, EPOLLOUT | EPOLLWRNORM);
+
+    if (err) {
+        if (0 != offset) {
+            atomic64_inc(&ch->stats.tx_frag_aborts);
+        }
+        return err;
+    }
+    atomic64_inc(&ch->stats.tx_msgs);
+    atomic64_add(length, &ch->stats.tx_bytes);
+    return 0;
+}
+
+/**
+* @brief WRITE function for Ipc module.
+*        This function is called whenever the character device driver is open
+*        for writing, e.g: a "echo" operation, via write or writev. Each
+*        user buffer holds a message intended to be sent: a buffer is
+*        allocated from the ones available for each of them and sent to the
+*        communication partner, or several ones on channels using
+*        fragmentation. Messages larger than the channel maximum message size
+*        are truncated, empty user buffers are skipped.
+*        If the local pools are exhausted, the caller is put to sleep until
+*        the remote core frees a buffer, for up to tx_timeout_ms, unless the
+*        file was opened with O_NONBLOCK, in which case -EAGAIN is returned.
+*
+* @param  iocb      I/O control block of the device driver file
+* @param  from      User buffers
+*
+* @return number of written bytes, if at least one message was sent, the
+*         error code of the first message otherwise: -EAGAIN/-ETIMEDOUT if
+*         no buffer is available, -ERESTARTSYS/-EFAULT or the IPCF error code.
+*/
+ssize_t ipcf_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+    int err = 0;
+    ssize_t ret = 0;
+    struct ipc_chan_descr_t *ch = ((struct ipc_file_t *)iocb->ki_filp->private_data)->ch;
+    bool nonblock = (iocb->ki_filp->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT);
+    size_t seg_len;
+    size_t length;
+
+    atomic64_inc(&ch->stats.write_calls);
+    trace_ipcf_write(ch->instance_id, ch->channel_id, iov_iter_count(from));
+
+    while (iov_iter_count(from)) {
+        seg_len = iov_iter_single_seg_count(from);
+        length = min_t(size_t, seg_len, ch->max_msg_size);
+        if (0 != length) {
+            if (NULL != ch->frag_rx) {
+                err = send_frag_msg_iter(ch, from, length, nonblock);
+            } else {
+                err = send_msg_iter(ch, from, length, nonblock);
+            }
+            if (err) {
+                break;
+            }
+            ret += length;
+        }
+        /* Skip the truncated part, the next message starts with the next
+           user buffer */
+        iov_iter_advance(from, seg_len - length);
+    }
+
+    return (0 == ret) ? err : ret;
+}
+
+/**
+* @brief  Poll function for ipc module, used by poll/select/epoll.
+*         The channel is reported readable while messages are pending
+*         in the round pool, with priority data while messages are pending
+*         in a priority lane above lane 0. Files open for writing are
+*         reported writable unless the last attempt to acquire a TX buffer
+*         failed and no spare buffer is kept, poll acquiring no buffer
+*         itself. Once the local pools are exhausted, the pollers are woken
+*         periodically to check them again, a non-blocking write may still
+*         find them exhausted and get -EAGAIN.
+*
+* @param  pfile     Pointer to the device driver file
+* @param  wait      Poll table on which the channel wait queues are registered
+*
+* @return mask of ready events
+*/
+__poll_t ipcf_poll(struct file *pfile, struct poll_table_struct *wait)
+{
+    __poll_t mask = 0;
+    struct ipc_file_t *f = pfile->private_data;
+    struct ipc_chan_descr_t *ch = f->ch;
+    uint8_t lane_id;
+
+    poll_wait(pfile, &ch->rx_wait_q, wait);
+    poll_wait(pfile, &ch->tx_wait_q, wait);
+
+    if (0 != get_file_pending_msg(f)) {
+        mask |= EPOLLIN | EPOLLRDNORM;
+    }
+    for (lane_id = 1; lane_id < ch->num_lanes; lane_id++) {
+        if (0 != get_lane_pending_msg(f, &ch->lanes[lane_id])) {
+            mask |= EPOLLPRI;
+            break;
+        }
+    }
+    if ((pfile->f_mode & FMODE_WRITE) && is_tx_ready(ch)) {
+        mask |= EPOLLOUT | EPOLLWRNORM;
+    }
+    return mask;
+}
+
+/**
+* @brief  Mmap function for ipc module.
+*         Maps the round buffer of the channel read-only in user space, so
+*         that the received messages can be processed in place, the remote
+*         shared memory holding the payloads of deferred release channels,
+*         or the TX window, so that messages can be written in place in the
+*         IPCF buffers. The layout of the mappings is described in ipc-chardev.h.
+*
+* @param  pfile     Pointer to the device driver file
+* @param  vma       User space memory area to be mapped
+*
+* @return 0 on success, -EINVAL/-EPERM on error
+*/
+int ipcf_mmap(struct file *pfile, struct vm_area_struct *vma)
+{
+    struct ipc_chan_descr_t *ch = ((struct ipc_file_t *)pfile->private_data)->ch;
+
+    if ((IPCF_MMAP_TX_WINDOW >> PAGE_SHIFT) == vma->vm_pgoff) {
+        /* The window is only known to match the IPCF layout once one of its
+           buffers was acquired, by IPCF_IOC_TX_WINDOW_INFO */
+        if (NULL == smp_load_acquire(&ch->tx_window_pool)) {
+            return -EINVAL;
+        }
+        if (!capable(CAP_SYS_RAWIO)) {
+            return -EPERM;
+        }
+        if ((vma->vm_end - vma->vm_start) > READ_ONCE(ch->tx_window_map_size)) {
+            return -EINVAL;
+        }
+        vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+        return io_remap_pfn_range(vma, vma->vm_start, PHYS_PFN(ch->tx_window_phys),
+                                  vma->vm_end - vma->vm_start, vma->vm_page_prot);
+    }
+
+    if ((IPCF_MMAP_RX_SHM >> PAGE_SHIFT) == vma->vm_pgoff) {
+        if (!ch->deferred_release) {
+            return -EINVAL;
+        }
+        if (!capable(CAP_SYS_RAWIO)) {
+            return -EPERM;
+        }
+        if (((vma->vm_end - vma->vm_start) > inst_remote_shm_size[ch->instance_id]) ||
+            (vma->vm_flags & VM_WRITE)) {
+            return -EINVAL;
+        }
+        vma->vm_flags &= ~VM_MAYWRITE;
+        vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+        return io_remap_pfn_range(vma, vma->vm_start,
+                                  PHYS_PFN(shm_cfg[ch->instance_id].remote_shm_addr),
+                                  vma->vm_end - vma->vm_start, vma->vm_page_prot);
+    }
+
+    if ((0 != vma->vm_pgoff) || ((vma->vm_end - vma->vm_start) > ch->ring_size)) {
+        return -EINVAL;
+    }
+    /* The ring is only written by the driver */
+    if (vma->vm_flags & VM_WRITE) {
+        return -EPERM;
+    }
+    vma->vm_flags &= ~VM_MAYWRITE;
+
+    /* The rings of all the lanes are mapped at once */
+    return remap_vmalloc_range(vma, ch->lanes[0].ring, 0);
+}
+
+/**
+* @brief  Ioctl function for ipc module, see ipc-chardev.h for the available
+*         commands.
+*
+* @param  pfile     Pointer to the device driver file
+* @param  cmd       Ioctl command
+* @param  arg       Command argument
+*
+* @return 0 on success, -ENOTTY/-EFAULT/-EINVAL/-ENOMEM/-EBADF on error
+*/
+long ipcf_ioctl(struct file *pfile, unsigned int cmd, unsigned long arg)
+{
+    struct ipc_file_t *f = pfile->private_data;
+    struct ipc_chan_descr_t *ch = f->ch;
+    struct ipcf_rx_ring_info ring_info;
+    struct ipcf_rx_lane_info lane_info;
+    struct ipcf_rx_lane_consume lane_consume;
+    struct ipcf_rx_cursor cursor_info;
+    struct ipcf_tx_window_info window_info;
+    uint32_t count;
+    uint32_t idx;
+
+    switch (cmd) {
+    case IPCF_IOC_RX_RING_INFO:
+        ring_info.map_size = ch->ring_size;
+        ring_info.num_slots = ch->lanes[0].queue_depth;
+        ring_info.slot_size = ch->slot_size;
+        ring_info.max_msg_size = ch->max_msg_size;
+        ring_info.flags = ch->lanes[0].ring->flags;
+        ring_info.shm_map_size = ch->deferred_release ? inst_remote_shm_size[ch->instance_id] : 0;
+        if (copy_to_user((void __user *)arg, &ring_info, sizeof(ring_info))) {
+            return -EFAULT;
+        }
+        return 0;
+    case IPCF_IOC_RX_CONSUME:
+        /* Only the readers move the consumer index */
+        if (!(pfile->f_mode & FMODE_READ)) {
+            return -EBADF;
+        }
+        if (get_user(count, (uint32_t __user *)arg)) {
+            return -EFAULT;
+        }
+        return consume_pending_buffs(f, &ch->lanes[0], count);
+    case IPCF_IOC_RX_LANE_INFO:
+        memset(&lane_info, 0, sizeof(lane_info));
+        lane_info.num_lanes = ch->num_lanes;
+        for (idx = 0; idx < ch->num_lanes; idx++) {
+            lane_info.lanes[idx].offset = ch->lanes[idx].ring_offset;
+            lane_info.lanes[idx].num_slots = ch->lanes[idx].queue_depth;
+        }
+        if (copy_to_user((void __user *)arg, &lane_info, sizeof(lane_info))) {
+            return -EFAULT;
+        }
+        return 0;
+    case IPCF_IOC_RX_LANE_CONSUME:
+        if (!(pfile->f_mode & FMODE_READ)) {
+            return -EBADF;
+        }
+        if (copy_from_user(&lane_consume, (void __user *)arg, sizeof(lane_consume))) {
+            return -EFAULT;
+        }
+        if (lane_consume.lane >= ch->num_lanes) {
+            return -EINVAL;
+        }
+        return consume_pending_buffs(f, &ch->lanes[lane_consume.lane], lane_consume.count);
+    case IPCF_IOC_RX_CURSOR:
+        memset(&cursor_info, 0, sizeof(cursor_info));
+        cursor_info.cursor = READ_ONCE(*get_read_cursor(f, &ch->lanes[0]));
+        cursor_info.pending = get_file_pending_msg(f);
+        cursor_info.overruns = READ_ONCE(f->overruns);
+        if (copy_to_user((void __user *)arg, &cursor_info, sizeof(cursor_info))) {
+            return -EFAULT;
+        }
+        return 0;
+    case IPCF_IOC_TX_WINDOW_INFO:
+        memset(&window_info, 0, sizeof(window_info));
+        if (0 == ch->tx_window_map_size) {
+            return -EINVAL;
+        }
+        window_info.num_bufs = inst_descr[ch->instance_id].chan_tx_window_bufs[ch->channel_id];
+        window_info.buf_size = ch->max_buf_size;
+        mutex_lock(&f->tx_window_lock);
+        refill_tx_window(f);
+        for (idx = 0; idx < IPCF_TX_WINDOW_MAX_BUFS; idx++) {
+            window_info.buf_offset[idx] = get_tx_window_offset(ch, f->tx_window[idx]);
+        }
+        mutex_unlock(&f->tx_window_lock);
+        /* Set once the window was checked against the first acquired buffer */
+        window_info.map_size = READ_ONCE(ch->tx_window_map_size);
+        if (copy_to_user((void __user *)arg, &window_info, sizeof(window_info))) {
+            return -EFAULT;
+        }
+        return 0;
+    case IPCF_IOC_TX_SUBMIT:
+        return submit_tx_window(f, (struct ipcf_tx_submit __user *)arg);
+    case IPCF_IOC_IDPS_STATS:
+        return get_idps_stats(ch, (struct ipcf_idps_stats __user *)arg, false);
+    case IPCF_IOC_IDPS_STATS_RESET:
+        return get_idps_stats(ch, (struct ipcf_idps_stats __user *)arg, true);
+    case IPCF_IOC_SET_FILTER:
+        return set_file_filter(f, (const struct ipcf_filter __user *)arg);
+    case IPCF_IOC_SET_LANE_FILTER:
+        return set_lane_filter(ch, (const struct ipcf_lane_filter __user *)arg);
+    default:
+        return -ENOTTY;
+    }
+}
+
+/**
+* @brief  Open function for ipc module
+*
+* @param  pinode    Pointer to the device driver directory
+* @param  pfile     Pointer to the device driver file
+*
+* @return 0, -EBUSY if a single consumer channel is already open for reading,
+*         -ENODEV until the link is initialized, -ENOMEM
+*/
+int ipcf_open(struct inode *pinode, struct file *pfile)
+{
+    struct ipc_chan_descr_t *ch = ipc_ch_descr[iminor(pinode)];
+    struct ipc_file_t *f;
+
+    /* The devices of a link being brought up cannot be used yet, the channel
+       descriptors are only kept once the link is initialized */
+    if (!smp_load_acquire(&ipcf_initialized)) {
+        return -ENODEV;
+    }
+    f = kzalloc(sizeof(*f), GFP_KERNEL);
+    if (NULL == f) {
+        return -ENOMEM;
+    }
+    f->ch = ch;
+    mutex_init(&f->filter_lock);
+    mutex_init(&f->read_lock);
+    mutex_init(&f->tx_window_lock);
+    /* Fan-out readers get the messages received from now on */
+    f->cursor = smp_load_acquire(&ch->lanes[0].ring->producer);
+
+    /* Single consumer channels accept only one reader */
+    if ((pfile->f_mode & FMODE_READ) && is_exclusive_reader(ch)) {
+        if (atomic_inc_return(&ch->num_readers) > 1) {
+            atomic_dec(&ch->num_readers);
+            kfree(f);
+            return -EBUSY;
+        }
+    }
+    pfile->private_data = f;
+    /* Reads and writes honour IOCB_NOWAIT, which lets io_uring issue them
+       inline and fall back to polling the channel instead of blocking a
+       worker thread */
+    pfile->f_mode |= FMODE_NOWAIT;
+    return 0;
+}
+
+/**
+* @brief  Close function for ipc module
+*
+* @param  pinode    Pointer to the device driver directory
+* @param  pfile     Pointer to the device driver file
+*
+* @return 0
+*/
+int ipcf_close(struct inode *pinode, struct file *pfile)
+{
+    struct ipc_file_t *f = pfile->private_data;
+    (void) pinode;
+
+    if ((pfile->f_mode & FMODE_READ) && is_exclusive_reader(f->ch)) {
+        atomic_dec(&f->ch->num_readers);
+    }
+    release_tx_window(f);
+    /* No reader is left evaluating the filter */
+    kfree(rcu_dereference_protected(f->filter, 1));
+    kfree(f);
+    return 0;
+}
+
+/* ==========================================================================
+ *                              EXPORTED FUNCTIONS
+ * ==========================================================================*/
+/**
+ *  @brief          Gets the descriptor of a channel, once the link is
+ *                  initialized
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @return         pointer to the channel descriptor, NULL if not found or if
+ *                  the link is not initialized yet
+ */
+static struct ipc_chan_descr_t *find_chan_descr(uint8_t inst_id, uint8_t chan_id)
+{
+    int cdev_idx = 0;
+    int idx;
+
+    /* Pairs with the release in ipcf_link_init, the descriptors and their
+       subscriber lists are initialized */
+    if (!smp_load_acquire(&ipcf_initialized)) {
+        return NULL;
+    }
+    if ((inst_id >= ipcf_num_instances) || (chan_id >= inst_descr[inst_id].channel_count)) {
+        return NULL;
+    }
+    for (idx = 0; idx < inst_id; idx++) {
+        cdev_idx += inst_descr[idx].channel_count;
+    }
+    return ipc_ch_descr[cdev_idx + chan_id];
+}
+
+/**
+ *  @brief          Subscribes to the messages received on a channel, see
+ *                  ipc-chardev-kapi.h
+ */
+int ipcf_chdev_subscribe(uint8_t inst_id, uint8_t chan_id, struct ipcf_chdev_subscriber *sub)
+{
+    struct ipc_chan_descr_t *ch;
+
+    if ((NULL == sub) || (NULL == sub->rx_cb)) {
+        return -EINVAL;
+    }
+    /* The link state only changes under the lock once initialized, so that
+       no subscriber is added to a channel being freed */
+    mutex_lock(&ipcf_subscribers_lock);
+    ch = find_chan_descr(inst_id, chan_id);
+    if (NULL == ch) {
+        mutex_unlock(&ipcf_subscribers_lock);
+        return -ENODEV;
+    }
+    list_add_tail_rcu(&sub->node, &ch->subscribers);
+    mutex_unlock(&ipcf_subscribers_lock);
+    return 0;
+}
+EXPORT_SYMBOL(ipcf_chdev_subscribe);
+
+/**
+ *  @brief          Cancels a subscription, see ipc-chardev-kapi.h
+ */
+void ipcf_chdev_unsubscribe(struct ipcf_chdev_subscriber *sub)
+{
+    mutex_lock(&ipcf_subscribers_lock);
+    list_del_rcu(&sub->node);
+    mutex_unlock(&ipcf_subscribers_lock);
+    /* Wait for the receive callbacks still running the subscriber */
+    synchronize_rcu();
+}
+EXPORT_SYMBOL(ipcf_chdev_unsubscribe);
+
+/**
+ *  @brief          Sends a message on a channel, see ipc-chardev-kapi.h
+ */
+int ipcf_chdev_send(uint8_t inst_id, uint8_t chan_id, const void *buf, size_t size)
+{
+    int err;
+    void *tx_buf = NULL;
+    struct kvec kv = {
+        .iov_base = (void *)buf,
+        .iov_len = size,
+    };
+    struct iov_iter iter;
+    struct ipc_chan_descr_t *ch = find_chan_descr(inst_id, chan_id);
+
+    if (NULL == ch) {
+        return -ENODEV;
+    }
+    if (size > ch->max_msg_size) {
+        return -EMSGSIZE;
+    }
+    if (NULL != ch->frag_rx) {
+        iov_iter_kvec(&iter, WRITE, &kv, 1, size);
+        return send_frag_msg_iter(ch, &iter, size, true);
+    }
+    err = get_tx_buf(ch, size, true, &tx_buf);
+    if (err) {
+        return err;
+    }
+    memcpy(tx_buf, buf, size);
+
+    trace_ipcf_tx_start(inst_id, chan_id, size);
+    err = ipc_shm_tx(inst_id, chan_id, tx_buf, size);
+    trace_ipcf_tx_end(inst_id, chan_id, size, err);
+    if (err) {
+        atomic64_inc(&ch->stats.tx_errors);
+        put_tx_spare(ch, tx_buf, size);
+        return err;
+    }
+    atomic64_inc(&ch->stats.tx_msgs);
+    atomic64_add(size, &ch->stats.tx_bytes);
+    return 0;
+}
+EXPORT_SYMBOL(ipcf_chdev_send);
+
+/**
+ *  @brief          Gets the statistics of a channel, see ipc-chardev-kapi.h
+ */
+int ipcf_chdev_get_stats(uint8_t inst_id, uint8_t chan_id, struct ipcf_chdev_stats *stats)
+{
+    struct ipc_chan_descr_t *ch = find_chan_descr(inst_id, chan_id);
+
+    if (NULL == ch) {
+        return -ENODEV;
+    }
+    stats->rx_msgs = READ_ONCE(ch->stats.rx_msgs);
+    stats->rx_bytes = READ_ONCE(ch->stats.rx_bytes);
+    stats->tx_msgs = atomic64_read(&ch->stats.tx_msgs);
+    stats->tx_bytes = atomic64_read(&ch->stats.tx_bytes);
+    stats->ring_overwrites = READ_ONCE(ch->stats.ring_overwrites);
+    stats->ring_drops = READ_ONCE(ch->stats.ring_drops);
+    stats->oversize_drops = READ_ONCE(ch->stats.oversize_drops);
+    stats->acquire_failures = atomic64_read(&ch->stats.acquire_failures);
+    stats->tx_errors = atomic64_read(&ch->stats.tx_errors);
+    stats->ring_occupancy = get_num_pending_msg(ch);
+    stats->ring_high_water = READ_ONCE(ch->stats.ring_high_water);
+    return 0;
+}
+EXPORT_SYMBOL(ipcf_chdev_get_stats);
+
+/* Defines a read-only sysfs attribute showing a channel statistic */
+#define IPC_CHAN_STAT_ATTR(_name, _value)                                       \
+static ssize_t _name##_show(struct device *dev, struct device_attribute *attr,  \
+                            char *buf)                                          \
+{                                                                               \
+    struct ipc_chan_descr_t *ch = dev_get_drvdata(dev);                         \
+    return sysfs_emit(buf, "%llu\n", (unsigned long long)(_value));             \
+}                                                                               \
+static DEVICE_ATTR_RO(_name)
+
+IPC_CHAN_STAT_ATTR(rx_msgs, READ_ONCE(ch->stats.rx_msgs));
+IPC_CHAN_STAT_ATTR(rx_bytes, READ_ONCE(ch->stats.rx_bytes));
+IPC_CHAN_STAT_ATTR(tx_msgs, atomic64_read(&ch->stats.tx_msgs));
+IPC_CHAN_STAT_ATTR(tx_bytes, atomic64_read(&ch->stats.tx_bytes));
+IPC_CHAN_STAT_ATTR(ring_overwrites, READ_ONCE(ch->stats.ring_overwrites));
+IPC_CHAN_STAT_ATTR(ring_drops, READ_ONCE(ch->stats.ring_drops));
+IPC_CHAN_STAT_ATTR(oversize_drops, READ_ONCE(ch->stats.oversize_drops));
+IPC_CHAN_STAT_ATTR(acquire_failures, atomic64_read(&ch->stats.acquire_failures));
+IPC_CHAN_STAT_ATTR(tx_errors, atomic64_read(&ch->stats.tx_errors));
+IPC_CHAN_STAT_ATTR(tx_waits, atomic64_read(&ch->stats.tx_waits));
+IPC_CHAN_STAT_ATTR(tx_timeouts, atomic64_read(&ch->stats.tx_timeouts));
+IPC_CHAN_STAT_ATTR(tx_copy_faults, atomic64_read(&ch->stats.tx_copy_faults));
+IPC_CHAN_STAT_ATTR(tx_buf_leaks, atomic64_read(&ch->stats.tx_buf_leaks));
+IPC_CHAN_STAT_ATTR(ring_occupancy, get_num_pending_msg(ch));
+IPC_CHAN_STAT_ATTR(ring_high_water, READ_ONCE(ch->stats.ring_high_water));
+IPC_CHAN_STAT_ATTR(ring_depth, get_num_ring_slots(ch));
+IPC_CHAN_STAT_ATTR(read_calls, atomic64_read(&ch->stats.read_calls));
+IPC_CHAN_STAT_ATTR(write_calls, atomic64_read(&ch->stats.write_calls));
+IPC_CHAN_STAT_ATTR(rx_filtered, atomic64_read(&ch->stats.rx_filtered));
+IPC_CHAN_STAT_ATTR(rx_frags, READ_ONCE(ch->stats.rx_frags));
+IPC_CHAN_STAT_ATTR(rx_frag_incomplete, READ_ONCE(ch->stats.rx_frag_incomplete));
+IPC_CHAN_STAT_ATTR(rx_frag_timeouts, READ_ONCE(ch->stats.rx_frag_timeouts));
+IPC_CHAN_STAT_ATTR(rx_frag_errors, READ_ONCE(ch->stats.rx_frag_errors));
+IPC_CHAN_STAT_ATTR(tx_frags, atomic64_read(&ch->stats.tx_frags));
+IPC_CHAN_STAT_ATTR(tx_frag_aborts, atomic64_read(&ch->stats.tx_frag_aborts));
+
+/**
+* @brief  Gets the name of an RX CPU affinity policy
+*
+* @param  policy    Affinity policy
+*
+* @return "any", "reader" or "cpu" for the policies pinning a CPU
+*/
+static const char *get_rx_cpu_policy_name(int policy)
+{
+    if (IPC_RX_CPU_ANY == policy) {
+        return "any";
+    }
+    return (IPC_RX_CPU_READER == policy) ? "reader" : "cpu";
+}
+
+/**
+* @brief  Shows the RX CPU affinity policy of the instance of a channel
+*/
+static ssize_t rx_cpu_policy_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ipc_chan_descr_t *ch = dev_get_drvdata(dev);
+    int policy = ipc_inst_affinity[ch->instance_id].policy;
+
+    if (policy >= 0) {
+        return sysfs_emit(buf, "%s %d\n", get_rx_cpu_policy_name(policy), policy);
+    }
+    return sysfs_emit(buf, "%s\n", get_rx_cpu_policy_name(policy));
+}
+static DEVICE_ATTR_RO(rx_cpu_policy);
+
+/**
+* @brief  Shows the CPU currently handling the RX path of the instance of a
+*         channel, -1 if not steered, or not moved yet to the CPU selected by
+*         its policy
+*/
+static ssize_t rx_cpu_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ipc_chan_descr_t *ch = dev_get_drvdata(dev);
+
+    return sysfs_emit(buf, "%d\n", READ_ONCE(ipc_inst_affinity[ch->instance_id].cpu));
+}
+static DEVICE_ATTR_RO(rx_cpu);
+
+/**
+* @brief  Shows the Linux RX interrupt of the instance of a channel, -1 if
+*         unknown
+*/
+static ssize_t rx_irq_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct ipc_chan_descr_t *ch = dev_get_drvdata(dev);
+    int irq = ipc_inst_affinity[ch->instance_id].irq;
+
+    return sysfs_emit(buf, "%d\n", (irq > 0) ? irq : -1);
+}
+static DEVICE_ATTR_RO(rx_irq);
+
+/* RX CPU affinity of the channel instance, shown as files under
+ * /sys/class/ipcfshm/ipcfshm!<instance>!<channel> */
+static struct attribute *ipcf_affinity_attrs[] = {
+    &dev_attr_rx_cpu_policy.attr,
+    &dev_attr_rx_cpu.attr,
+    &dev_attr_rx_irq.attr,
+    NULL
+};
+
+static const struct attribute_group ipcf_affinity_group = {
+    .attrs = ipcf_affinity_attrs,
+};
+
+/* Channel statistics, shown as files under
+ * /sys/class/ipcfshm/ipcfshm!<instance>!<channel>/statistics */
+static struct attribute *ipcf_stats_attrs[] = {
+    &dev_attr_rx_msgs.attr,
+    &dev_attr_rx_bytes.attr,
+    &dev_attr_tx_msgs.attr,
+    &dev_attr_tx_bytes.attr,
+    &dev_attr_ring_overwrites.attr,
+    &dev_attr_ring_drops.attr,
+    &dev_attr_oversize_drops.attr,
+    &dev_attr_acquire_failures.attr,
+    &dev_attr_tx_errors.attr,
+    &dev_attr_tx_waits.attr,
+    &dev_attr_tx_timeouts.attr,
+    &dev_attr_tx_copy_faults.attr,
+    &dev_attr_tx_buf_leaks.attr,
+    &dev_attr_ring_occupancy.attr,
+    &dev_attr_ring_high_water.attr,
+    &dev_attr_ring_depth.attr,
+    &dev_attr_read_calls.attr,
+    &dev_attr_write_calls.attr,
+    &dev_attr_rx_filtered.attr,
+    &dev_attr_rx_frags.attr,
+    &dev_attr_rx_frag_incomplete.attr,
+    &dev_attr_rx_frag_timeouts.attr,
+    &dev_attr_rx_frag_errors.attr,
+    &dev_attr_tx_frags.attr,
+    &dev_attr_tx_frag_aborts.attr,
+    NULL
+};
+
+static const struct attribute_group ipcf_stats_group = {
+    .name = "statistics",
+    .attrs = ipcf_stats_attrs,
+};
+
+static const struct attribute_group *ipcf_dev_groups[] = {
+    &ipcf_stats_group,
+    &ipcf_affinity_group,
+    NULL
+};
+
+/**
+* @brief  Shows the RX latency histogram of a channel, from the receive
+*         callback until the message is consumed by user space
+*
+* @param  s         Sequence file, holding the channel descriptor
+* @param  unused    N/A
+*
+* @return 0
+*/
+static int ipcf_rx_latency_show(struct seq_file *s, void *unused)
+{
+    struct ipc_chan_descr_t *ch = s->private;
+    uint32_t bucket;
+
+    seq_printf(s, "%-24s %s\n", "latency [ns]", "messages");
+    for (bucket = 0; bucket < IPC_LAT_HIST_BUCKETS; bucket++) {
+        seq_printf(s, "[%10llu, %10llu) %llu\n", (bucket > 0) ? BIT_ULL(bucket) : 0,
+                   BIT_ULL(bucket + 1),
+                   (unsigned long long)atomic64_read(&ch->stats.rx_latency[bucket]));
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ipcf_rx_latency);
+
+/**
+* @brief  Shows the polled RX mode counters of an instance
+*
+* @param  s         seq_file, private data being the polled RX state
+* @param  unused    Unused
+*
+* @return 0
+*/
+static int ipcf_rx_poll_show(struct seq_file *s, void *unused)
+{
+    struct ipc_inst_poll_t *poll = s->private;
+
+    seq_printf(s, "period_us %lld\n", ktime_to_us(poll->period));
+    seq_printf(s, "backoff %u\n", READ_ONCE(poll->backoff));
+    seq_printf(s, "polls %llu\n", (unsigned long long)atomic64_read(&poll->polls));
+    seq_printf(s, "msgs %llu\n", (unsigned long long)atomic64_read(&poll->msgs));
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ipcf_rx_poll);
+
+/**
+* @brief  Creates the debugfs files of the channels, under
+*         /sys/kernel/debug/ipcfshm/<instance>!<channel>. Failures are not
+*         fatal, the files are then missing.
+*
+* @return N/A
+*/
+static void ipcf_debugfs_init(void)
+{
+    int cdev_idx = 0;
+    int inst_id = 0;
+    int ch_id = 0;
+    char name[2 * MAX_NAME_SIZE];
+    struct dentry *dir;
+
+    ipcf_debugfs_root = debugfs_create_dir(DEVICE_NAME, NULL);
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        for (ch_id = 0; ch_id < inst_descr[inst_id].channel_count; ch_id++) {
+            snprintf(name, sizeof(name), "%s!%s", inst_descr[inst_id].instance_name,
+                     inst_descr[inst_id].channel_names[ch_id]);
+            dir = debugfs_create_dir(name, ipcf_debugfs_root);
+            debugfs_create_file("rx_latency", 0444, dir, ipc_ch_descr[cdev_idx],
+                                &ipcf_rx_latency_fops);
+            if (inst_descr[inst_id].chan_echo_bench[ch_id]) {
+                ipc_ch_descr[cdev_idx]->bench = ipcf_bench_create(dir, inst_id, ch_id);
+                if (IS_ERR(ipc_ch_descr[cdev_idx]->bench)) {
+                    ipc_ch_descr[cdev_idx]->bench = NULL;
+                }
+            }
+            cdev_idx++;
+        }
+        if (0 != ktime_to_ns(ipc_inst_poll[inst_id].period)) {
+            snprintf(name, sizeof(name), "%s!rx_poll", inst_descr[inst_id].instance_name);
+            debugfs_create_file(name, 0444, ipcf_debugfs_root, &ipc_inst_poll[inst_id],
+                                &ipcf_rx_poll_fops);
+        }
+    }
+}
+
+/**
+* @brief  Configures the instances using the polled RX mode, before IPCF is
+*         initialized: their RX interrupt is disabled and their poll timer
+*         prepared.
+*
+* @return N/A
+*/
+static void init_rx_poll(void)
+{
+    int inst_id = 0;
+    int i;
+    uint32_t period_us;
+    struct ipc_inst_poll_t *poll;
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        poll = &ipc_inst_poll[inst_id];
+        poll->instance_id = inst_id;
+        poll->period = 0;
+        period_us = (0 != rx_poll_us[inst_id]) ? rx_poll_us[inst_id] :
+                    inst_descr[inst_id].rx_poll_period_us;
+        if (0 == period_us) {
+            continue;
+        }
+        poll->period = us_to_ktime(period_us);
+        poll->backoff = 1;
+        hrtimer_init(&poll->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+        poll->timer.function = rx_poll_timer_fn;
+
+        poll->rx_irq = shm_cfg[inst_id].inter_core_rx_irq;
+        shm_cfg[inst_id].inter_core_rx_irq = IPC_IRQ_NONE;
+        for (i = 0; i < ipcf_num_channels; i++) {
+            if (ipc_ch_descr[i]->instance_id == inst_id) {
+                ipc_ch_descr[i]->rx_polled = true;
+            }
+        }
+    }
+}
+
+/**
+* @brief  Restores the RX interrupt of the instances using the polled RX mode,
+*         once IPCF is freed or failed to initialize, so that the next
+*         initialization starts from the instance configuration.
+*
+* @return N/A
+*/
+static void free_rx_poll(void)
+{
+    int inst_id = 0;
+    struct ipc_inst_poll_t *poll;
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        poll = &ipc_inst_poll[inst_id];
+        if (0 == ktime_to_ns(poll->period)) {
+            continue;
+        }
+        shm_cfg[inst_id].inter_core_rx_irq = poll->rx_irq;
+        poll->period = 0;
+    }
+}
+
+/**
+* @brief  Starts or stops the poll timers of the instances using the polled
+*         RX mode
+*
+* @param  start     true to start the timers, false to stop them
+*
+* @return N/A
+*/
+static void run_rx_poll(bool start)
+{
+    int inst_id = 0;
+    struct ipc_inst_poll_t *poll;
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        poll = &ipc_inst_poll[inst_id];
+        if (0 == ktime_to_ns(poll->period)) {
+            continue;
+        }
+        if (start) {
+            hrtimer_start(&poll->timer, poll->period, HRTIMER_MODE_REL_SOFT);
+        } else {
+            hrtimer_cancel(&poll->timer);
+        }
+    }
+}
+
+/**
+* @brief  Sets the RX CPU affinity policy of the instances, from the instance
+*         configuration and the module parameters, before IPCF is
+*         initialized. The inter-core interrupt of the instances pinned to
+*         one of the trusted A53 cores is routed to this core. Other
+*         instances need their RX interrupt in the device tree, or the
+*         polled RX mode, to be steered, their policy is rejected otherwise.
+*         Shall be called after init_rx_poll.
+*
+* @return N/A
+*/
+static void init_rx_affinity(void)
+{
+    int inst_id = 0;
+    int cpu;
+    struct ipc_inst_affinity_t *aff;
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        aff = &ipc_inst_affinity[inst_id];
+        aff->policy = inst_descr[inst_id].rx_cpu;
+        aff->cpu = -1;
+        aff->target = -1;
+        aff->stopping = false;
+        INIT_WORK(&aff->work, rx_affinity_work_fn);
+
+        if (NULL != rx_cpu[inst_id]) {
+            if (sysfs_streq(rx_cpu[inst_id], "any")) {
+                aff->policy = IPC_RX_CPU_ANY;
+            } else if (sysfs_streq(rx_cpu[inst_id], "reader")) {
+                aff->policy = IPC_RX_CPU_READER;
+            } else if (kstrtoint(rx_cpu[inst_id], 0, &cpu) || (cpu < 0)) {
+                printk(KERN_WARNING "Unknown RX CPU affinity %s for %s\n",
+                       rx_cpu[inst_id], inst_descr[inst_id].instance_name);
+            } else {
+                aff->policy = cpu;
+            }
+        }
+        if ((aff->policy >= 0) &&
+            (((unsigned int)aff->policy >= nr_cpu_ids) || !cpu_online(aff->policy))) {
+            printk(KERN_WARNING "CPU %d is not available, RX CPU affinity of %s "
+                   "disabled\n", aff->policy, inst_descr[inst_id].instance_name);
+            aff->policy = IPC_RX_CPU_ANY;
+        }
+        if ((aff->policy >= 0) && (aff->policy < IPC_NUM_RX_CORES)) {
+            shm_cfg[inst_id].local_core.index = (enum ipc_shm_core_index)(1u << aff->policy);
+        } else if ((IPC_RX_CPU_ANY != aff->policy) && (aff->irq <= 0) &&
+                   (0 == ktime_to_ns(ipc_inst_poll[inst_id].period))) {
+            /* Neither an interrupt nor a poll timer to be moved */
+            printk(KERN_WARNING "No RX interrupt described for %s, RX CPU affinity "
+                   "disabled\n", inst_descr[inst_id].instance_name);
+            aff->policy = IPC_RX_CPU_ANY;
+        }
+    }
+}
+
+/**
+* @brief  Starts or stops steering the RX path of the instances. Instances
+*         pinned to a CPU are moved to it when started.
 *
-* @return ERROR or 0
+* @param  start     true to start steering, false to stop it
+*
+* @return N/A
 */
-static int __init ipcf_module_init(void)
+static void run_rx_affinity(bool start)
+{
+    int inst_id = 0;
+    struct ipc_inst_affinity_t *aff;
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        aff = &ipc_inst_affinity[inst_id];
+        if (IPC_RX_CPU_ANY == aff->policy) {
+            continue;
+        }
+        if (!start) {
+            WRITE_ONCE(aff->stopping, true);
+            cancel_work_sync(&aff->work);
+            continue;
+        }
+        if (aff->policy >= 0) {
+            aff->target = aff->policy;
+            queue_work_on(aff->target, system_highpri_wq, &aff->work);
+        }
+    }
+}
+
+/**
+* @brief  Creates the network devices of the channels configured with a
+*         network device front end. Failures are not fatal, the channels
+*         are then only available as character devices.
+*
+* @return N/A
+*/
+static void ipcf_netdev_init(void)
 {
-    int err;
     int cdev_idx = 0;
-    dev_t dev;
     int inst_id = 0;
     int ch_id = 0;
-    uint32_t M7_0_stat = 0;
-    struct device *pdev = NULL;
+    struct net_device *dev;
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        for (ch_id = 0; ch_id < inst_descr[inst_id].channel_count; ch_id++, cdev_idx++) {
+            if (!inst_descr[inst_id].chan_netdev[ch_id]) {
+                continue;
+            }
+            dev = ipcf_netdev_create(inst_id, ch_id, ipc_ch_descr[cdev_idx]->max_msg_size);
+            if (IS_ERR(dev)) {
+                printk(KERN_ALERT "Failed to create network device for %s!%s \n",
+                       inst_descr[inst_id].instance_name,
+                       inst_descr[inst_id].channel_names[ch_id]);
+                continue;
+            }
+            ipc_ch_descr[cdev_idx]->netdev = dev;
+        }
+    }
+}
+
+/**
+* @brief  Checks whether an M7 core is running
+*
+* @param  core      M7 core index
+*
+* @return true if the core is running, false otherwise
+*/
+static bool is_m7_core_active(uint8_t core)
+{
+    uint32_t stat;
+    void __iomem *reg = ioremap(M7_CORE_STAT_REG(core), M7_CORE_STAT_REG_SIZE);
+
+    if (NULL == reg) {
+        printk(KERN_ALERT "Failed to map M7_%u core status register \n", core);
+        return false;
+    }
+    stat = ioread32(reg);
+    iounmap(reg);
+    return M7_CORE_ACTIVE == (stat & M7_CORE_ACTIVE);
+}
+
+/**
+* @brief  Sets the shared memory layout of an instance within its device tree
+*         region: the remote area, holding the M7 TX pools, followed by the
+*         local area. The area sizes are given by the module parameters, else
+*         by the device tree node, else by the instance configuration, and
+*         are checked against the region and the channel pools.
+*
+* @param  inst_id   Instance id
+* @param  np        Device tree node of the instance
+* @param  res       Shared memory region of the instance
+*
+* @return 0 on success, -EINVAL on an invalid layout
+*/
+static int init_inst_shm_layout(uint8_t inst_id, struct device_node *np,
+                                const struct resource *res)
+{
+    struct ipc_shm_cfg *cfg = &shm_cfg[inst_id];
+    const char *name = inst_descr[inst_id].instance_name;
+    uint32_t local_size = cfg->shm_size;
+    uint32_t remote_size = inst_remote_shm_size[inst_id];
+    uint32_t footprint = get_inst_shm_footprint(inst_id);
+
+    /* Optional, the configuration being used when the properties are absent */
+    of_property_read_u32(np, "nxp,local-shm-size", &local_size);
+    of_property_read_u32(np, "nxp,remote-shm-size", &remote_size);
+    if (0 != shm_size[inst_id]) {
+        local_size = shm_size[inst_id];
+    }
+    if (0 != remote_shm_size[inst_id]) {
+        remote_size = remote_shm_size[inst_id];
+    }
+
+    /* The areas are mapped to user space by pages */
+    if ((0 == local_size) || (0 == remote_size) ||
+        !PAGE_ALIGNED(local_size) || !PAGE_ALIGNED(remote_size)) {
+        printk(KERN_ALERT "The shared memory areas of %s shall be non empty and page aligned\n",
+               name);
+        return -EINVAL;
+    }
+    if (((resource_size_t)local_size + remote_size) > resource_size(res)) {
+        printk(KERN_ALERT "The shared memory areas of %s, %#x bytes remote and %#x bytes local, "
+               "exceed its %#llx bytes region\n", name, remote_size, local_size,
+               (unsigned long long)resource_size(res));
+        return -EINVAL;
+    }
+    if (footprint > min(local_size, remote_size)) {
+        printk(KERN_ALERT "The channels of %s need up to %#x bytes in each shared memory area, "
+               "%#x bytes remote and %#x bytes local available\n", name, footprint,
+               remote_size, local_size);
+        return -EINVAL;
+    }
+
+    cfg->remote_shm_addr = res->start;
+    cfg->local_shm_addr = res->start + remote_size;
+    cfg->shm_size = local_size;
+    inst_remote_shm_size[inst_id] = remote_size;
+    return 0;
+}
+
+/**
+* @brief  Sets the remote M7 core and the RX inter-core interrupt of an
+*         instance from the nxp,remote-core and nxp,inter-core-rx-irq
+*         properties of its device tree node. The remote core defaults to the
+*         M7 core of the instance index, the interrupt to the instance
+*         configuration. Each M7 core can be the remote core of one instance
+*         only.
+*
+* @param  inst_id   Instance id
+* @param  np        Device tree node of the instance
+*
+* @return 0 on success, -EINVAL on an invalid or already used M7 core
+*/
+static int init_inst_remote_core(uint8_t inst_id, struct device_node *np)
+{
+    uint32_t core = inst_id;
+    uint32_t rx_irq;
+    uint8_t idx;
+
+    /* Optional, the defaults being used when the properties are absent */
+    of_property_read_u32(np, "nxp,remote-core", &core);
+    if (core >= IPC_NUM_M7_CORES) {
+        printk(KERN_ALERT "Invalid remote core %u for %s\n", core,
+               inst_descr[inst_id].instance_name);
+        return -EINVAL;
+    }
+    for (idx = 0; idx < inst_id; idx++) {
+        if (inst_m7_core[idx] == core) {
+            printk(KERN_ALERT "M7_%u core is the remote core of both %s and %s\n", core,
+                   inst_descr[idx].instance_name, inst_descr[inst_id].instance_name);
+            return -EINVAL;
+        }
+    }
+    inst_m7_core[inst_id] = (uint8_t)core;
+    shm_cfg[inst_id].remote_core.index = (enum ipc_shm_core_index)(1u << core);
+    if (0 == of_property_read_u32(np, "nxp,inter-core-rx-irq", &rx_irq)) {
+        shm_cfg[inst_id].inter_core_rx_irq = (int)rx_irq;
+    }
+    return 0;
+}
+
+/**
+* @brief  Sets the shared memory of the instances from the device tree, one
+*         nxp,s32g-ipcf-shm node per instance, in instance order. The
+*         instances are set up to the first one without a node or whose M7
+*         core is not running.
+*
+* @return number of instances, -EAGAIN if the M7 core of the first instance
+*         is not running yet, -ENODEV if no instance is available, error code
+*         of an invalid node otherwise
+*/
+static int init_instances_from_dt(void)
+{
+    struct device_node *np = NULL;
     struct resource res;
-    struct device_node *np;
-    struct ipc_shm_instances_cfg shm_instances_cfg = {
-        .num_instances = IPC_NUM_INSTANCES,
-        .shm_cfg = shm_cfg
-    };
+    int num = 0;
+    int err = 0;
 
-    /* Find a node by its "compatible" property */
-    for (inst_id = 0; inst_id < IPC_NUM_INSTANCES; inst_id++) {
-        np = of_find_compatible_node(NULL, NULL, ipcf_res_no_map_name[inst_id].compatible);
+    while (num < IPC_NUM_INSTANCES) {
+        np = of_find_compatible_node(np, NULL, IPCF_SHM_COMPATIBLE);
         if (!np) {
-            printk(KERN_ERR "The node was not found by its compatible: %s\n", ipcf_res_no_map_name[inst_id].compatible);
-            return -ENODEV;
+            break;
         }
-         /* Translate device tree address and return as resource */
+        /* Translate device tree address and return as resource */
         err = of_address_to_resource(np, 0, &res);
         /* Check if reg property is available */
         if (err < 0) {
             printk(KERN_ERR "The node has invalid reg property\n");
-            return err;
+            break;
+        }
+        err = init_inst_shm_layout(num, np, &res);
+        if (err < 0) {
+            break;
+        }
+        err = init_inst_remote_core(num, np);
+        if (err < 0) {
+            break;
         }
-        shm_instances_cfg.shm_cfg[inst_id].remote_shm_addr = res.start;
-        shm_instances_cfg.shm_cfg[inst_id].local_shm_addr = res.start + IPC_SHM_SIZE;
+        if (!is_m7_core_active(inst_m7_core[num])) {
+            if (num > 0) {
+                printk(KERN_ALERT "%s core is not started, its instance is not initialized\n",
+                       inst_descr[num].instance_name);
+            } else {
+                /* The link is brought up once the first remote core runs */
+                err = -EAGAIN;
+            }
+            break;
+        }
+        /* Optional, allows steering the RX interrupt */
+        ipc_inst_affinity[num].irq = of_irq_get(np, 0);
+        num++;
     }
+    of_node_put(np);
 
-    uint32_t *pM7_0_stat = ioremap(M7_0_CORE_STAT_REG, M7_0_CORE_STAT_REG_SIZE);
-    if (IS_ERR(pM7_0_stat)) {
-        printk (KERN_ALERT "Failed to map M7_0 core status register \n");
-        return -EFAULT;
+    if (err < 0) {
+        return err;
     }
-    M7_0_stat = ioread32(pM7_0_stat);
-    iounmap(pM7_0_stat);
-    /* Check if M7 is up */
-    if (M7_0_CORE_ACTIVE != (M7_0_stat & M7_0_CORE_ACTIVE)) {
-        printk(KERN_ALERT "M7_0 core is not started, %s module will not be inserted\n", 
+    if (0 == num) {
+        printk(KERN_ALERT "No IPCF instance available, %s module will not be started\n",
                MODULE_NAME);
-        return -EFAULT;
+        return -ENODEV;
+    }
+    if (num < IPC_NUM_INSTANCES) {
+        printk(KERN_WARNING "Only %d of %u IPCF instances initialized\n", num,
+               IPC_NUM_INSTANCES);
+    }
+    return num;
+}
+
+/**
+* @brief  This function ensures that the files have the same permissions
+*
+* @param  dev               Pointer to the device
+* @param  kobj_uevent_env   Event
+*
+* @return 0
+*/
+static int ipcfshm_uevent(struct device *dev, struct kobj_uevent_env *env)
+{
+    add_uevent_var(env, "DEVMODE=%#o", 0666);
+    return 0;
+}
+
+/**
+* @brief  This function will register character device driver for ipc
+*         This function is called by the link work once the remote core of the
+*         first instance runs, it initializes IPCF and creates the devices.
+*
+* @return 0, -EAGAIN if the remote core is not running yet, ERROR otherwise,
+*         everything being undone on error so that the link work can retry
+*/
+static int ipcf_link_init(void)
+{
+    int err;
+    int cdev_idx = 0;
+    dev_t dev;
+    int inst_id = 0;
+    int ch_id = 0;
+    struct device *pdev = NULL;
+    struct ipc_shm_instances_cfg shm_instances_cfg = {
+        .num_instances = 0,
+        .shm_cfg = shm_cfg
+    };
+
+    err = init_instances_from_dt();
+    if (err < 0) {
+        return err;
+    }
+    ipcf_num_instances = err;
+    shm_instances_cfg.num_instances = ipcf_num_instances;
+    ipcf_num_channels = 0;
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        ipcf_num_channels += inst_descr[inst_id].channel_count;
     }
 
     err = alloc_chrdev_region(&dev, 0, IPC_NUM_CHANNELS, DEVICE_NAME);
@@ -589,81 +4805,331 @@ static int __init ipcf_module_init(void)
     dev_major = MAJOR(dev);
 
     ipcfshm_class = class_create(THIS_MODULE, DEVICE_NAME);
-    if (NULL == ipcfshm_class) {
+    if (IS_ERR(ipcfshm_class)) {
         printk(KERN_ALERT "Failed to create device class for %s \n", DEVICE_NAME);
+        err = PTR_ERR(ipcfshm_class);
+        ipcfshm_class = NULL;
         goto free_chdev_region;
     }
     ipcfshm_class->dev_uevent = ipcfshm_uevent;
 
-    for (inst_id = 0; inst_id < IPC_NUM_INSTANCES; inst_id++) {
+    err = alloc_chan_rings();
+    if (err) {
+        printk(KERN_ALERT "Failed to allocate channel buffers \n");
+        goto free_class;
+    }
+    /* Initialize local variables in case they were written previously */
+    init_state_vars();
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
         for (ch_id = 0; ch_id < inst_descr[inst_id].channel_count; ch_id++) {
-            ipc_ch_descr[cdev_idx].instance_id = inst_id;
-            ipc_ch_descr[cdev_idx].channel_id = ch_id;
+            ipc_ch_descr[cdev_idx]->instance_id = inst_id;
+            ipc_ch_descr[cdev_idx]->channel_id = ch_id;
+            /* Received messages are dispatched straight to the descriptor */
+            shm_cfg[inst_id].channels[ch_id].ch.managed.cb_arg = ipc_ch_descr[cdev_idx];
+            cdev_idx++;
+        }
+    }
+    init_rx_poll();
+    init_rx_affinity();
+    init_tx_windows();
+    err = ipc_shm_init(&shm_instances_cfg);
+    if (err) {
+        printk(KERN_ALERT "Failed to initialize IPCF \n");
+        goto free_rings;
+    }
 
-            cdev_init(&(ipc_ch_descr[cdev_idx].chardev), &ipcf_file_operations);
-            ipc_ch_descr[cdev_idx].chardev.owner = THIS_MODULE;
+    /* The devices are only created for an initialized IPCF, and cannot be
+       opened before the link is published: no file is open on the channels
+       freed by a failed attempt */
+    cdev_idx = 0;
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        for (ch_id = 0; ch_id < inst_descr[inst_id].channel_count; ch_id++) {
+            cdev_init(&(ipc_ch_descr[cdev_idx]->chardev), &ipcf_file_operations);
+            ipc_ch_descr[cdev_idx]->chardev.owner = THIS_MODULE;
 
-            if (0 != cdev_add(&(ipc_ch_descr[cdev_idx].chardev), MKDEV(dev_major, cdev_idx), 1)) {
+            err = cdev_add(&(ipc_ch_descr[cdev_idx]->chardev), MKDEV(dev_major, cdev_idx), 1);
+            if (0 != err) {
                 printk(KERN_ALERT "Failed to add device in rootfs \n");
                 goto free_cdev;
             }
             /* Create character device driver */
-            pdev = device_create(ipcfshm_class, NULL, MKDEV(dev_major, cdev_idx), NULL,
-                                 "%s!%s!%s", DEVICE_NAME, inst_descr[inst_id].instance_name,
-                                 inst_descr[inst_id].channel_names[ch_id]);
+            pdev = device_create_with_groups(ipcfshm_class, NULL, MKDEV(dev_major, cdev_idx),
+                                             ipc_ch_descr[cdev_idx], ipcf_dev_groups,
+                                             "%s!%s!%s", DEVICE_NAME,
+                                             inst_descr[inst_id].instance_name,
+                                             inst_descr[inst_id].channel_names[ch_id]);
             if (IS_ERR(pdev)) {
-                cdev_del(&(ipc_ch_descr[cdev_idx].chardev));
+                cdev_del(&(ipc_ch_descr[cdev_idx]->chardev));
                 printk(KERN_ALERT "Failed to insert device in rootfs \n");
+                err = PTR_ERR(pdev);
                 goto free_cdev;
             }
             cdev_idx++;
         }
     }
-    /* Initialize local variables in case they were written previously */
-    init_state_vars();
-
-    if (ipc_shm_init(&shm_instances_cfg)) {
-        printk(KERN_ALERT "Failed to initialize IPCF \n");
-        goto free_cdev;
-    }
+    run_rx_poll(true);
+    run_rx_affinity(true);
+    /* The exported functions may use the channels from now on, before the
+       network devices and benchmarks relying on them are created */
+    smp_store_release(&ipcf_initialized, true);
+    ipcf_debugfs_init();
+    ipcf_netdev_init();
     return 0;
 
 free_cdev:
     for (cdev_idx = cdev_idx - 1; cdev_idx >= 0; cdev_idx--) {
-        cdev_del(&(ipc_ch_descr[cdev_idx].chardev));
+        cdev_del(&(ipc_ch_descr[cdev_idx]->chardev));
         device_destroy(ipcfshm_class, MKDEV(dev_major, cdev_idx));
     }
+    ipc_shm_free();
+
+free_rings:
+    free_rx_poll();
+    free_chan_rings();
+
+free_class:
     class_unregister(ipcfshm_class);
     class_destroy(ipcfshm_class);
+    ipcfshm_class = NULL;
 
 free_chdev_region:
-    unregister_chrdev_region(MKDEV(dev_major, 0), MINORMASK);
+    unregister_chrdev_region(MKDEV(dev_major, 0), IPC_NUM_CHANNELS);
 
-    return -EFAULT;
+    return err;
 }
 
 /**
 * @brief  This function will un-register character device driver for ipc
-*         This function is called whenever the character device driver being
-*         unregistered in the kernel via the rmmod functionality.
+*         This function is called when the platform device is removed, via
+*         the rmmod functionality, if the link was initialized.
 *
 * @return N/A
 */
-static void __exit ipcf_module_exit(void)
+static void ipcf_link_free(void)
 {
     int i;
 
-    for (i = 0; i < IPC_NUM_CHANNELS; i++) {
-        cdev_del(&(ipc_ch_descr[i].chardev));
+    for (i = 0; i < ipcf_num_channels; i++) {
+        ipcf_bench_destroy(ipc_ch_descr[i]->bench);
+        ipc_ch_descr[i]->bench = NULL;
+    }
+    debugfs_remove_recursive(ipcf_debugfs_root);
+    run_rx_affinity(false);
+    run_rx_poll(false);
+
+    for (i = 0; i < ipcf_num_channels; i++) {
+        ipcf_netdev_destroy(ipc_ch_descr[i]->netdev);
+        ipc_ch_descr[i]->netdev = NULL;
+    }
+
+    for (i = 0; i < ipcf_num_channels; i++) {
+        cancel_delayed_work_sync(&ipc_ch_descr[i]->tx_retry_work);
+    }
+
+    for (i = 0; i < ipcf_num_channels; i++) {
+        cdev_del(&(ipc_ch_descr[i]->chardev));
         device_destroy(ipcfshm_class, MKDEV(dev_major, i));
     }
 
-    unregister_chrdev_region(MKDEV(dev_major, 0), MINORMASK);
+    unregister_chrdev_region(MKDEV(dev_major, 0), IPC_NUM_CHANNELS);
 
     class_unregister(ipcfshm_class);
     class_destroy(ipcfshm_class);
 
     ipc_shm_free();
+    free_rx_poll();
+    free_chan_rings();
+}
+
+/**
+* @brief  Checks whether the remote cores of all initialized instances run
+*
+* @return true if all remote cores are running, false otherwise
+*/
+static bool are_m7_cores_active(void)
+{
+    int inst_id = 0;
+
+    for (inst_id = 0; inst_id < ipcf_num_instances; inst_id++) {
+        if (!is_m7_core_active(inst_m7_core[inst_id])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+* @brief  Updates the link state, emitting a change uevent with IPCF_LINK=up
+*         or IPCF_LINK=down on the platform device when it changes
+*
+* @param  up        New link state
+*
+* @return N/A
+*/
+static void set_link_state(bool up)
+{
+    char *up_envp[] = { "IPCF_LINK=up", NULL };
+    char *down_envp[] = { "IPCF_LINK=down", NULL };
+
+    if (up == ipcf_link_active) {
+        return;
+    }
+    WRITE_ONCE(ipcf_link_active, up);
+    printk(KERN_INFO "IPCF link %s\n", up ? "up" : "down");
+    kobject_uevent_env(&ipcf_pdev->dev.kobj, KOBJ_CHANGE, up ? up_envp : down_envp);
+}
+
+/**
+* @brief  Link work: polls the M7 core status with backoff until IPCF can be
+*         initialized, then monitors the remote cores of the initialized
+*         instances. Initialization failures are retried with the same
+*         backoff. A remote core which stops only reports the link down,
+*         the devices stay available.
+*
+* @param  work      Link work
+*
+* @return N/A
+*/
+static void ipcf_link_work_fn(struct work_struct *work)
+{
+    int err;
+    unsigned int delay_ms = IPC_LINK_MONITOR_MS;
+
+    if (!ipcf_initialized) {
+        err = ipcf_link_init();
+        if (err) {
+            /* Only report a change of the failure cause */
+            if ((-EAGAIN == err) && (err != ipcf_link_err)) {
+                printk(KERN_INFO "Waiting for %s core to start\n", inst_descr[0].instance_name);
+            } else if (err != ipcf_link_err) {
+                printk(KERN_ALERT "Failed to bring the IPCF link up, err code %d, "
+                       "retrying\n", err);
+            }
+            ipcf_link_err = err;
+            delay_ms = ipcf_link_retry_ms;
+            ipcf_link_retry_ms = min_t(unsigned int, 2 * ipcf_link_retry_ms,
+                                       IPC_LINK_RETRY_MAX_MS);
+            schedule_delayed_work(&ipcf_link_work, msecs_to_jiffies(delay_ms));
+            return;
+        }
+        ipcf_link_err = 0;
+        set_link_state(true);
+    } else {
+        set_link_state(are_m7_cores_active());
+    }
+    schedule_delayed_work(&ipcf_link_work, msecs_to_jiffies(delay_ms));
+}
+
+/**
+* @brief  Shows the link state of the driver, up or down
+*/
+static ssize_t link_state_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%s\n", READ_ONCE(ipcf_link_active) ? "up" : "down");
+}
+static DEVICE_ATTR_RO(link_state);
+
+/* Link state, shown under /sys/devices/platform/ipcfshm */
+static struct attribute *ipcf_link_attrs[] = {
+    &dev_attr_link_state.attr,
+    NULL
+};
+
+static const struct attribute_group ipcf_link_group = {
+    .attrs = ipcf_link_attrs,
+};
+
+static const struct attribute_group *ipcf_link_groups[] = {
+    &ipcf_link_group,
+    NULL
+};
+
+/**
+* @brief  Probe function of the platform driver, starts the link work without
+*         waiting for the remote core
+*
+* @param  pdev      Platform device
+*
+* @return 0
+*/
+static int ipcf_probe(struct platform_device *pdev)
+{
+    ipcf_link_retry_ms = IPC_LINK_RETRY_MIN_MS;
+    ipcf_link_err = 0;
+    INIT_DELAYED_WORK(&ipcf_link_work, ipcf_link_work_fn);
+    schedule_delayed_work(&ipcf_link_work, 0);
+    return 0;
+}
+
+/**
+* @brief  Remove function of the platform driver, brings the link down
+*
+* @param  pdev      Platform device
+*
+* @return 0
+*/
+static int ipcf_remove(struct platform_device *pdev)
+{
+    cancel_delayed_work_sync(&ipcf_link_work);
+    set_link_state(false);
+    if (ipcf_initialized) {
+        mutex_lock(&ipcf_subscribers_lock);
+        WRITE_ONCE(ipcf_initialized, false);
+        mutex_unlock(&ipcf_subscribers_lock);
+        ipcf_link_free();
+    }
+    return 0;
+}
+
+/* Platform driver, probed asynchronously so that loading the module does not
+ * wait for the remote core */
+static struct platform_driver ipcf_platform_driver = {
+    .probe = ipcf_probe,
+    .remove = ipcf_remove,
+    .driver = {
+        .name = DEVICE_NAME,
+        .dev_groups = ipcf_link_groups,
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS,
+    },
+};
+
+/**
+* @brief  This function registers the platform driver and its device
+*         This function is called whenever the character device driver being registered in the
+*         kernel via insmod function.
+*
+* @return ERROR or 0
+*/
+static int __init ipcf_module_init(void)
+{
+    int err;
+
+    err = platform_driver_register(&ipcf_platform_driver);
+    if (err) {
+        printk(KERN_ALERT "Failed to register platform driver %s \n", DEVICE_NAME);
+        return err;
+    }
+    ipcf_pdev = platform_device_register_simple(DEVICE_NAME, PLATFORM_DEVID_NONE, NULL, 0);
+    if (IS_ERR(ipcf_pdev)) {
+        printk(KERN_ALERT "Failed to register platform device %s \n", DEVICE_NAME);
+        platform_driver_unregister(&ipcf_platform_driver);
+        return PTR_ERR(ipcf_pdev);
+    }
+    return 0;
+}
+
+/**
+* @brief  This function unregisters the platform device and driver
+*         This function is called whenever the character device driver being
+*         unregistered in the kernel via the rmmod functionality.
+*
+* @return N/A
+*/
+static void __exit ipcf_module_exit(void)
+{
+    platform_device_unregister(ipcf_pdev);
+    platform_driver_unregister(&ipcf_platform_driver);
 }
 
 /* ==========================================================================
@@ -0,0 +1,599 @@
+/**
+*   @file       ipc-chardev.h
+*   @brief      User space interface of the IPCF character device driver
+*
+*   This header is shared between the driver and the user space applications
+*   which use the extended interface of the /dev/ipcfshm channels.
+*/
+/* ==========================================================================
+*   (c) Copyright 2022 NXP
+*   All Rights Reserved.
+=============================================================================*/
+#ifndef __IPCF_CHARDEV__H__
+#define __IPCF_CHARDEV__H__
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/* ==========================================================================
+ * RX RING LAYOUT
+ * ==========================================================================
+ * Each channel stores the received messages in a round buffer which can be
+ * mapped read-only in user space via mmap, at offset 0, using the map_size
+ * returned by IPCF_IOC_RX_RING_INFO. The mapping starts with the ring header,
+ * followed at slots_offset by num_slots slots of slot_size bytes each.
+ * Each slot starts with a slot header, holding the size and metadata of the
+ * message, followed by the message payload.
+ *
+ * The layout is cache line aligned: the producer and consumer indices are
+ * alone on their cache lines, as well as each slot, whose size is a multiple
+ * of IPCF_RX_RING_LINE_SIZE, so that the driver receiving a message and the
+ * readers processing the previous ones do not share cache lines.
+ *
+ * producer and consumer are free running message counters, the message with
+ * index i is stored in slot (i % num_slots). Messages in [consumer, producer)
+ * are pending. num_slots is a power of two. On channels using the overwrite
+ * policy, the driver never waits for the readers: when producer is more than
+ * num_slots ahead of consumer, the oldest messages were overwritten and
+ * reading continues from (producer - num_slots). A reader processing
+ * messages in place shall:
+ *  - read producer with acquire semantics (or read it, then issue a read
+ *    memory barrier) before accessing slots
+ *  - for each pending message i, check that seq of its slot equals i, process
+ *    the payload, issue a read memory barrier and check seq again. A changed
+ *    seq means the slot was overwritten by a newer message in the meantime
+ *  - advance the consumer index via IPCF_IOC_RX_CONSUME, which also releases
+ *    the slots for the read() interface
+ * Unless the channel allows multiple consumers or fan-out, only one file can
+ * be open for reading on a channel, the process owning it being the single
+ * consumer. The consume ioctls require a file open for reading, reads and
+ * consume calls of a file being serialized by the driver.
+ *
+ * On channels using deferred release (IPCF_RX_RING_F_DEFERRED set in flags),
+ * the slots do not hold the payload: the slot header is followed by a slot
+ * reference, giving the offset of the payload in the remote shared memory of
+ * the channel instance. This memory can be mapped read-only via mmap at
+ * offset IPCF_MMAP_RX_SHM, using the shm_map_size returned by
+ * IPCF_IOC_RX_RING_INFO, which requires CAP_SYS_RAWIO. The IPCF buffers are
+ * held until consumed, hence the slots are never overwritten.
+ *
+ * On channels using fragmentation with messages larger than a slot
+ * (IPCF_RX_RING_F_FRAG_STORE set in flags), the slots are sized to the IPCF
+ * buffers. The slots whose size exceeds (slot_size - sizeof(struct
+ * ipcf_rx_slot_hdr)) do not hold the payload: the slot header is followed by
+ * a slot reference, giving the offset in the RX ring mapping of an entry of
+ * the fragmentation store. The entry starts with its own slot header,
+ * followed by the payload. Its seq shall equal the seq of the reference,
+ * before and after processing the payload, as the entries of the store are
+ * reused by newer large messages, the oldest one first.
+ *
+ * On fan-out channels (IPCF_RX_RING_F_FAN_OUT set in flags), any number of
+ * files can be open for reading, each one with its own read cursor, starting
+ * at the producer index when the file is opened. The consumer index of the
+ * ring header is then not used: IPCF_IOC_RX_CONSUME advances the cursor of
+ * the file and IPCF_IOC_RX_CURSOR returns it, together with the number of
+ * pending messages and of messages overwritten before being read through
+ * the file.
+ */
+
+/* Version of the ring layout, stored in the ring header */
+#define IPCF_RX_RING_VERSION            3u
+
+/* Cache line size the ring layout is aligned to */
+#define IPCF_RX_RING_LINE_SIZE          64u
+
+/* Ring flag: slots hold references to the IPCF buffers */
+#define IPCF_RX_RING_F_DEFERRED         0x1u
+/* Ring flag: each file has its own read cursor */
+#define IPCF_RX_RING_F_FAN_OUT          0x2u
+/* Ring flag: the channel has several priority lanes, this ring being one of
+   them, see IPCF_IOC_RX_LANE_INFO */
+#define IPCF_RX_RING_F_LANES            0x4u
+/* Ring flag: messages larger than a slot are kept in the fragmentation
+   store of the mapping, referenced by their slots */
+#define IPCF_RX_RING_F_FRAG_STORE       0x8u
+
+/* mmap offset of the remote shared memory, for deferred release channels */
+#define IPCF_MMAP_RX_SHM                0x20000000u
+
+/* RX ring header, located at the start of the mapping */
+struct ipcf_rx_ring_hdr {
+    /* Ring layout version, IPCF_RX_RING_VERSION */
+    __u32 version;
+    /* Number of slots in the ring */
+    __u32 num_slots;
+    /* Size of a slot, including the slot header */
+    __u32 slot_size;
+    /* Offset of the first slot from the start of the mapping */
+    __u32 slots_offset;
+    /* Ring flags, IPCF_RX_RING_F_* */
+    __u32 flags;
+    __u8  reserved0[IPCF_RX_RING_LINE_SIZE - 5 * sizeof(__u32)];
+    /* Number of messages written by the driver */
+    __u32 producer;
+    __u8  reserved1[IPCF_RX_RING_LINE_SIZE - sizeof(__u32)];
+    /* Number of messages consumed by the readers */
+    __u32 consumer;
+    __u8  reserved2[IPCF_RX_RING_LINE_SIZE - sizeof(__u32)];
+};
+
+/* RX ring slot header, followed by the message payload */
+struct ipcf_rx_slot_hdr {
+    /* Payload size */
+    __u32 size;
+    /* Index of the message stored in the slot */
+    __u32 seq;
+    /* Reception time, in ns, as in the frame header */
+    __u64 timestamp;
+    /* Sequence number of the message, as in the frame header */
+    __u32 frame_seq;
+    /* Frame flags, IPCF_FRAME_F_* */
+    __u16 flags;
+    /* Reserved */
+    __u16 reserved;
+};
+
+/* RX ring slot reference, follows the slot header on deferred release
+   channels and for the messages kept in the fragmentation store */
+struct ipcf_rx_slot_ref {
+    /* Offset of the payload in the remote shared memory mapping, or of the
+       store entry in the RX ring mapping */
+    __u32 offset;
+    /* Index of the message in the fragmentation store, matching the seq of
+       the store entry header while the entry holds it. Reserved on deferred
+       release channels */
+    __u32 seq;
+};
+
+/* RX ring geometry, as returned by IPCF_IOC_RX_RING_INFO */
+struct ipcf_rx_ring_info {
+    /* Size to be passed to mmap */
+    __u32 map_size;
+    /* Number of slots in the ring */
+    __u32 num_slots;
+    /* Size of a slot, including the slot header */
+    __u32 slot_size;
+    /* Maximum message size, larger than the payload of a slot on channels
+       using the fragmentation store */
+    __u32 max_msg_size;
+    /* Ring flags, IPCF_RX_RING_F_* */
+    __u32 flags;
+    /* Size to be passed to mmap for the remote shared memory, 0 if the
+       channel does not use deferred release */
+    __u32 shm_map_size;
+};
+
+/* Read cursor of a file, as returned by IPCF_IOC_RX_CURSOR */
+struct ipcf_rx_cursor {
+    /* Index of the next message to be consumed */
+    __u32 cursor;
+    /* Number of messages pending for the file, the lag behind the producer */
+    __u32 pending;
+    /* Number of messages overwritten before being read through the file */
+    __u64 overruns;
+};
+
+/* ==========================================================================
+ * FRAME HEADER
+ * ==========================================================================
+ * Channels configured with the extended frame header return each message
+ * read via read() preceded by a frame header, in native byte order, instead
+ * of the big-endian data size. The header starts with its version and size:
+ * later versions only append fields, so readers shall skip hdr_size bytes to
+ * reach the payload.
+ *
+ * seq counts all the messages received from the remote core on the channel,
+ * a gap in the sequence numbers shows the messages which never reached the
+ * reader, the flags giving the reason. timestamp is taken with the
+ * monotonic clock (CLOCK_MONOTONIC) when the message is received.
+ */
+
+/* Version of the frame header */
+#define IPCF_FRAME_HDR_VERSION          1u
+
+/* Frame flag: messages preceding this one were dropped by the driver, as the
+   round buffer was full or the messages did not fit in its slots */
+#define IPCF_FRAME_F_DROPPED            0x1u
+/* Frame flag: messages preceding this one were overwritten in the round
+   buffer before being read */
+#define IPCF_FRAME_F_OVERWRITTEN        0x2u
+
+/* Frame header, preceding the payload of each message */
+struct ipcf_frame_hdr {
+    /* Frame header version, IPCF_FRAME_HDR_VERSION */
+    __u8  version;
+    /* Size of the frame header, offset of the payload */
+    __u8  hdr_size;
+    /* Frame flags, IPCF_FRAME_F_* */
+    __u16 flags;
+    /* Payload size */
+    __u32 size;
+    /* Reception time, in ns */
+    __u64 timestamp;
+    /* Sequence number of the message */
+    __u32 seq;
+    /* Reserved, set to 0 */
+    __u32 reserved;
+};
+
+/* ==========================================================================
+ * FRAGMENTATION
+ * ==========================================================================
+ * Channels configured with fragmentation carry messages larger than the
+ * IPCF buffers: each message is sent as a train of IPCF messages, each one
+ * starting with a fragment header, in little-endian byte order, followed by
+ * the next part of the payload. The fragments of a message are sent in
+ * order and are not interleaved with other messages of the channel. The
+ * remote core shall use the same framing on the channel.
+ *
+ * The driver reassembles the received fragments before the message becomes
+ * visible to the readers, which only see whole messages, up to the maximum
+ * message size of the channel (max_msg_size of IPCF_IOC_RX_RING_INFO). The
+ * messages larger than a slot are kept in the fragmentation store, see RX
+ * RING LAYOUT, which holds the last few of them: a large message is dropped
+ * while the store entry to be reused holds a message still pending on a
+ * lane not using the overwrite policy. A
+ * message whose fragments are missing, out of order, or not completed
+ * within 100 ms is discarded and counted in the rx_frag_* statistics of the
+ * channel. Writes are split in fragments transparently and are truncated to
+ * the maximum message size. TX window buffers are sent as they are, each one
+ * shall then start with a fragment header filled by the application.
+ */
+
+/* Fragment header, preceding the payload of each IPCF message */
+struct ipcf_frag_hdr {
+    /* Size of the whole message */
+    __le32 msg_size;
+    /* Offset of the fragment payload in the message, 0 for the first one */
+    __le32 offset;
+    /* Sequence number of the message, shared by all its fragments */
+    __le16 msg_seq;
+    /* Reserved, set to 0 */
+    __le16 reserved;
+};
+
+/* ==========================================================================
+ * TX WINDOW LAYOUT
+ * ==========================================================================
+ * Channels configured with a TX window keep, for each open file, a set of
+ * IPCF buffers acquired on behalf of user space from the pool of the largest
+ * buffers of the channel. This pool can be mapped read-write via mmap at
+ * offset IPCF_MMAP_TX_WINDOW, after IPCF_IOC_TX_WINDOW_INFO, using the
+ * map_size it returns, along with the offset of each buffer of the file in
+ * the mapping. Mapping the window requires CAP_SYS_RAWIO, as the
+ * mapping is rounded to whole pages and covers the buffers acquired via the
+ * other files of the channel.
+ *
+ * The application fills a buffer in place and passes its window index and
+ * payload size, which shall not be 0, to IPCF_IOC_TX_SUBMIT. Only the
+ * buffers of the submitting file are sent. Each submitted buffer is handed
+ * over to the remote core and replaced by a newly acquired buffer, whose
+ * offset is returned in the submitted descriptor. An index for which no new
+ * buffer could be acquired is reported with IPCF_TX_BUF_NONE and is refilled
+ * by the next IPCF_IOC_TX_WINDOW_INFO call. As IPCF cannot take back an
+ * acquired buffer, the buffers of a closed file are kept for the next files
+ * using the window.
+ */
+
+/* mmap offset of the TX window */
+#define IPCF_MMAP_TX_WINDOW             0x10000000u
+
+/* Maximum number of buffers in a TX window */
+#define IPCF_TX_WINDOW_MAX_BUFS         16u
+
+/* Marker for window indices without an acquired buffer */
+#define IPCF_TX_BUF_NONE                0xFFFFFFFFu
+
+/* TX window geometry, as returned by IPCF_IOC_TX_WINDOW_INFO */
+struct ipcf_tx_window_info {
+    /* Size to be passed to mmap */
+    __u32 map_size;
+    /* Number of buffers in the window */
+    __u32 num_bufs;
+    /* Maximum payload size of a buffer */
+    __u32 buf_size;
+    /* Reserved, set to 0 */
+    __u32 reserved;
+    /* Offset of each buffer in the mapping, or IPCF_TX_BUF_NONE */
+    __u32 buf_offset[IPCF_TX_WINDOW_MAX_BUFS];
+};
+
+/* TX window buffer descriptor, used by IPCF_IOC_TX_SUBMIT */
+struct ipcf_tx_desc {
+    /* Index of the buffer in the window */
+    __u32 index;
+    /* Payload size */
+    __u32 size;
+    /* Returned offset of the buffer replacing the submitted one,
+       or IPCF_TX_BUF_NONE */
+    __u32 offset;
+    /* Reserved, set to 0 */
+    __u32 reserved;
+};
+
+/* TX window submission, used by IPCF_IOC_TX_SUBMIT */
+struct ipcf_tx_submit {
+    /* User space pointer to an array of count descriptors */
+    __u64 descs;
+    /* Number of descriptors */
+    __u32 count;
+    /* Returned number of buffers handed over to the remote core. On error,
+       the descriptors starting from this index were not sent */
+    __u32 submitted;
+};
+
+/* ==========================================================================
+ * IDPS RECORD AGGREGATION
+ * ==========================================================================
+ * Channels configured with the IDPS aggregator decode each received message
+ * as an IDPS record, struct ipcf_idps_record, in little-endian byte order,
+ * optionally followed by dbg_data_len bytes of debug data. The records are
+ * counted per engine, bus and detection tag, and the most frequent message
+ * ids are tracked, all returned at once by IPCF_IOC_IDPS_STATS. The messages
+ * are still queued for the readers.
+ *
+ * The message id table keeps the IPCF_IDPS_TOP_N most frequent ids using the
+ * space-saving algorithm: an id seen for the first time when the table is
+ * full replaces the least frequent one, inheriting its count. The count of
+ * an entry thus overestimates the occurrences of its id by at most error,
+ * and any id occurring more often than records / IPCF_IDPS_TOP_N is in the
+ * table.
+ */
+
+/* Size of an IDPS record, without the debug data */
+#define IPCF_IDPS_RECORD_SIZE           22u
+
+/* Number of engine, bus and detection tag counters, larger values being
+   counted in the corresponding *_other counter */
+#define IPCF_IDPS_MAX_ENGINES           4u
+#define IPCF_IDPS_MAX_BUSES             32u
+#define IPCF_IDPS_MAX_TAGS              32u
+
+/* Number of entries of the message id table */
+#define IPCF_IDPS_TOP_N                 16u
+
+/* Engine ids of the IDPS records */
+#define IPCF_IDPS_ENGINE_LLCE           0u
+#define IPCF_IDPS_ENGINE_M7             1u
+
+/* IDPS record, as received from the remote core */
+struct ipcf_idps_record {
+    __u8  engine_id;
+    __u8  idps_status;
+    __u32 timestamp;
+    __u32 message_id;
+    __u32 bus_id;
+    __u32 detection_tag;
+    __u32 dbg_data_len;
+} __attribute__((packed));
+
+/* Entry of the message id table */
+struct ipcf_idps_msg_count {
+    /* Message id */
+    __u32 message_id;
+    /* Reserved, set to 0 */
+    __u32 reserved;
+    /* Number of records counted for the message id */
+    __u64 count;
+    /* Maximum overestimation of count */
+    __u64 error;
+};
+
+/* IDPS counters, as returned by IPCF_IOC_IDPS_STATS */
+struct ipcf_idps_stats {
+    /* Number of decoded records */
+    __u64 records;
+    /* Number of messages shorter than a record, not decoded */
+    __u64 malformed;
+    /* Records per engine id */
+    __u64 engines[IPCF_IDPS_MAX_ENGINES];
+    __u64 engines_other;
+    /* Records per bus id */
+    __u64 buses[IPCF_IDPS_MAX_BUSES];
+    __u64 buses_other;
+    /* Records per detection tag */
+    __u64 tags[IPCF_IDPS_MAX_TAGS];
+    __u64 tags_other;
+    /* Timestamp of the last decoded record */
+    __u32 last_timestamp;
+    /* Number of valid entries of the message id table */
+    __u32 top_count;
+    /* Message id table, sorted by decreasing count */
+    struct ipcf_idps_msg_count top[IPCF_IDPS_TOP_N];
+};
+
+/* ==========================================================================
+ * MESSAGE FILTERS
+ * ==========================================================================
+ * A reader may install a filter on its file via IPCF_IOC_SET_FILTER, so that
+ * read() only returns the messages matching it: the other ones are consumed
+ * for this file without being copied. Each rule reads a little-endian field
+ * of 1, 2 or 4 bytes at the given payload offset and compares it, masked,
+ * with the rule value. A message matches when all rules are true, or any of
+ * them with IPCF_FILTER_F_MATCH_ANY; messages too short to hold a field do
+ * not satisfy its rule. A filter without rules removes the current one.
+ *
+ * E.g. the IDPS records of bus 3 with a non-zero status are selected by
+ *   { .offset = 10, .width = 4, .op = IPCF_FILTER_OP_EQ, .mask = 0xFFFFFFFF, .value = 3 }
+ *   { .offset = 1,  .width = 1, .op = IPCF_FILTER_OP_NE, .mask = 0xFF,       .value = 0 }
+ *
+ * Filters apply to fan-out and single consumer channels, on multiple consumer
+ * channels a message skipped by a reader would be lost for the other ones.
+ * They do not apply to the messages consumed in place via IPCF_IOC_RX_CONSUME,
+ * and poll may signal the file readable for messages which are then filtered
+ * out, a non-blocking read returning -EAGAIN.
+ */
+
+/* Maximum number of rules of a filter */
+#define IPCF_FILTER_MAX_RULES           8u
+
+/* Comparison operators of the filter rules */
+#define IPCF_FILTER_OP_EQ               0u
+#define IPCF_FILTER_OP_NE               1u
+
+/* A message matches if any rule is true instead of all of them */
+#define IPCF_FILTER_F_MATCH_ANY         (1u << 0)
+
+/* Filter rule, true if (field & mask) op value */
+struct ipcf_filter_rule {
+    /* Offset of the field in the payload */
+    __u16 offset;
+    /* Size of the field, 1, 2 or 4 bytes */
+    __u8  width;
+    /* Comparison operator, IPCF_FILTER_OP_* */
+    __u8  op;
+    /* Mask applied to the field */
+    __u32 mask;
+    /* Value compared to the masked field */
+    __u32 value;
+};
+
+/* Message filter, installed by IPCF_IOC_SET_FILTER */
+struct ipcf_filter {
+    /* Number of valid rules, 0 to remove the filter */
+    __u32 num_rules;
+    /* IPCF_FILTER_F_* flags */
+    __u32 flags;
+    /* Filter rules */
+    struct ipcf_filter_rule rules[IPCF_FILTER_MAX_RULES];
+};
+
+/* ==========================================================================
+ * PRIORITY LANES
+ * ==========================================================================
+ * A channel may be configured with several priority lanes, each one being a
+ * round buffer of its own, with its own depth and overflow policy, so that
+ * urgent messages are neither delayed nor overwritten by bulk traffic. Lane
+ * 0 is the bulk lane, higher lanes having higher priorities: read() always
+ * returns the messages of the highest non-empty lane first, and poll reports
+ * EPOLLPRI while a lane above lane 0 has pending messages. Messages of
+ * different lanes are thus not read in reception order, seq in the frame
+ * header still counting all the messages of the channel.
+ *
+ * The lane of a received message is selected by the lane filters installed
+ * via IPCF_IOC_SET_LANE_FILTER, the highest lane whose filter matches being
+ * used, then by the priority byte set by the remote core, at the payload
+ * offset configured for the channel, values above the last lane selecting
+ * the last one. Other messages go to lane 0. Lane filters apply to all the
+ * readers of the channel, hence require CAP_SYS_ADMIN.
+ *
+ * The lanes are laid out one after the other in the RX ring mapping, lane 0
+ * first, each one starting with a ring header and using the layout described
+ * in RX RING LAYOUT. IPCF_IOC_RX_RING_INFO describes lane 0 and the size of
+ * the whole mapping, IPCF_IOC_RX_LANE_INFO gives the offset and depth of each
+ * lane, whose messages are consumed in place via IPCF_IOC_RX_LANE_CONSUME.
+ * Priority lanes are not available on deferred release and fan-out channels.
+ */
+
+/* Maximum number of priority lanes of a channel */
+#define IPCF_RX_MAX_LANES               4u
+
+/* Priority lane geometry, as returned by IPCF_IOC_RX_LANE_INFO */
+struct ipcf_rx_lane_info {
+    /* Number of lanes, 1 if the channel has no priority lanes */
+    __u32 num_lanes;
+    /* Reserved */
+    __u32 reserved;
+    struct {
+        /* Offset of the ring header of the lane in the RX ring mapping */
+        __u32 offset;
+        /* Number of slots of the lane */
+        __u32 num_slots;
+    } lanes[IPCF_RX_MAX_LANES];
+};
+
+/* Messages to be consumed from a lane, used by IPCF_IOC_RX_LANE_CONSUME */
+struct ipcf_rx_lane_consume {
+    /* Lane index */
+    __u32 lane;
+    /* Number of messages to consume */
+    __u32 count;
+};
+
+/* Lane filter, installed by IPCF_IOC_SET_LANE_FILTER */
+struct ipcf_lane_filter {
+    /* Lane index, above 0 */
+    __u32 lane;
+    /* Reserved, set to 0 */
+    __u32 reserved;
+    /* Messages matching the filter go to the lane, a filter without rules
+       removes the current one */
+    struct ipcf_filter filter;
+};
+
+/* ==========================================================================
+ * ASYNCHRONOUS I/O
+ * ==========================================================================
+ * The channels support non-blocking reads and writes (O_NONBLOCK or
+ * IOCB_NOWAIT) together with poll, so they can be driven by epoll or
+ * io_uring event loops: io_uring reads are first issued inline and, if no
+ * message is pending, completed once the receive callback signals the
+ * channel readable, without a blocked worker thread. Several reads may be
+ * queued on multiple consumer channels to get one completion per message
+ * (or per batch on channels using batched reads).
+ */
+
+/* ==========================================================================
+ * SPLICE
+ * ==========================================================================
+ * The channels support splice() into a pipe, and thus sendfile(), so that
+ * the received messages can be forwarded to a socket without being copied
+ * to user space, e.g.
+ *   splice(chan_fd, NULL, pipe_fd[1], NULL, 65536, 0);
+ *   splice(pipe_fd[0], NULL, sock_fd, NULL, ret, SPLICE_F_MOVE);
+ * Each call returns the same data as read() with a buffer of the size of
+ * the free space of the pipe: the messages are never split and are only
+ * delimited on the stream by the size prefix or frame header, so channels
+ * spliced into stream sockets shall use one of them, together with batched
+ * reads to forward several messages per call. The pipe shall have room for
+ * the largest message of the channel, or the call fails with -EINVAL. The
+ * call blocks until a message is received, unless the channel is opened
+ * with O_NONBLOCK.
+ */
+
+/* ==========================================================================
+ * LINK STATE
+ * ==========================================================================
+ * The driver waits for the remote core in the background, loading the
+ * module does not fail when the M7 core is not started yet. The channel
+ * devices are created once the link is up. Failures to bring the link up
+ * are logged and retried in the background as well, up to once per second.
+ * IPCF is initialized once, for the instances whose remote core runs when
+ * the remote core of the first instance is found running: the instances
+ * whose remote core starts later get no devices until the module is
+ * reloaded. The link state is shown in
+ * /sys/devices/platform/ipcfshm/link_state, each change is notified by a
+ * change uevent of this device, carrying IPCF_LINK=up or IPCF_LINK=down,
+ * e.g. matched by the udev rule:
+ *   ACTION=="change", SUBSYSTEM=="platform", KERNEL=="ipcfshm", ENV{IPCF_LINK}=="up"
+ */
+
+/* ==========================================================================
+ * IOCTL COMMANDS
+ * ==========================================================================*/
+#define IPCF_IOC_MAGIC                  0xCF
+
+/* Get the RX ring geometry */
+#define IPCF_IOC_RX_RING_INFO           _IOR(IPCF_IOC_MAGIC, 0x01, struct ipcf_rx_ring_info)
+/* Consume the given number of pending messages from the RX ring */
+#define IPCF_IOC_RX_CONSUME             _IOW(IPCF_IOC_MAGIC, 0x02, __u32)
+/* Get the TX window geometry, acquiring the missing window buffers */
+#define IPCF_IOC_TX_WINDOW_INFO         _IOR(IPCF_IOC_MAGIC, 0x03, struct ipcf_tx_window_info)
+/* Send one or more TX window buffers */
+#define IPCF_IOC_TX_SUBMIT              _IOWR(IPCF_IOC_MAGIC, 0x04, struct ipcf_tx_submit)
+/* Get the read cursor of the file */
+#define IPCF_IOC_RX_CURSOR              _IOR(IPCF_IOC_MAGIC, 0x05, struct ipcf_rx_cursor)
+/* Get the IDPS counters of the channel */
+#define IPCF_IOC_IDPS_STATS             _IOR(IPCF_IOC_MAGIC, 0x06, struct ipcf_idps_stats)
+/* Get the IDPS counters of the channel, then reset them */
+#define IPCF_IOC_IDPS_STATS_RESET       _IOR(IPCF_IOC_MAGIC, 0x07, struct ipcf_idps_stats)
+/* Install the message filter of the file, or remove it */
+#define IPCF_IOC_SET_FILTER             _IOW(IPCF_IOC_MAGIC, 0x08, struct ipcf_filter)
+/* Get the priority lane geometry */
+#define IPCF_IOC_RX_LANE_INFO           _IOR(IPCF_IOC_MAGIC, 0x09, struct ipcf_rx_lane_info)
+/* Consume the given number of pending messages from a priority lane */
+#define IPCF_IOC_RX_LANE_CONSUME        _IOW(IPCF_IOC_MAGIC, 0x0A, struct ipcf_rx_lane_consume)
+/* Install the filter selecting the messages of a priority lane, or remove it */
+#define IPCF_IOC_SET_LANE_FILTER        _IOW(IPCF_IOC_MAGIC, 0x0B, struct ipcf_lane_filter)
+
+#endif /* __IPCF_CHARDEV__H__ */
@@ -13,9 +13,11 @@
 #define S32G74A
 #endif /* PLATFORM */
 
-#if defined(S32G74A)
+/* Settings shared by the S32G2 and S32G3 platforms, which only differ by
+   their number of M7 cores */
+#if defined(S32G74A) || defined(S32G399A)
 
-/* Shared memory size, half for local, half for remote */
+/* Default size of each shared memory area, local and remote */
 #ifndef IPC_SHM_SIZE
 #define IPC_SHM_SIZE                0x80000
 #endif /* IPC_SHM_SIZE */
@@ -30,13 +32,123 @@
 #define IPC_QUEUE_SIZE 	            64u
 #endif /* IPC_QUEUE_SIZE */
 
-/* M7_0 core status register */
+/* IPCF buffer size classes of the channels using multiple memory pools,
+   enabled via IPC_SIZE_CLASS_POOLS */
+#ifndef IPCF_BUF_LEN_SMALL
+#define IPCF_BUF_LEN_SMALL          64u
+#endif /* IPCF_BUF_LEN_SMALL */
+
+#ifndef IPCF_BUF_LEN_MEDIUM
+#define IPCF_BUF_LEN_MEDIUM         512u
+#endif /* IPCF_BUF_LEN_MEDIUM */
+
+#ifndef IPCF_BUF_LEN_LARGE
+#define IPCF_BUF_LEN_LARGE          4096u
+#endif /* IPCF_BUF_LEN_LARGE */
+
+/* Number of IPCF buffers of each size class */
+#ifndef IPC_QUEUE_SIZE_SMALL
+#define IPC_QUEUE_SIZE_SMALL        64u
+#endif /* IPC_QUEUE_SIZE_SMALL */
+
+#ifndef IPC_QUEUE_SIZE_MEDIUM
+#define IPC_QUEUE_SIZE_MEDIUM       16u
+#endif /* IPC_QUEUE_SIZE_MEDIUM */
+
+#ifndef IPC_QUEUE_SIZE_LARGE
+#define IPC_QUEUE_SIZE_LARGE        4u
+#endif /* IPC_QUEUE_SIZE_LARGE */
+
+/* Local shared memory area size of each instance, holding the A53 TX pools.
+   The instance shared memory regions are given by the nxp,s32g-ipcf-shm
+   device tree nodes, in instance order, each holding the remote area followed
+   by the local area. The sizes can be overridden by the nxp,local-shm-size
+   and nxp,remote-shm-size node properties, then by the shm_size and
+   remote_shm_size module parameters. The pools of a channel are laid out the
+   same way in both areas, thus shall match the remote core configuration,
+   and each area shall be large enough to hold them */
+#ifndef IPC_INST_0_SHM_SIZE
+#define IPC_INST_0_SHM_SIZE         IPC_SHM_SIZE
+#endif /* IPC_INST_0_SHM_SIZE */
+
+#ifndef IPC_INST_1_SHM_SIZE
+#define IPC_INST_1_SHM_SIZE         IPC_SHM_SIZE
+#endif /* IPC_INST_1_SHM_SIZE */
+
+#ifndef IPC_INST_2_SHM_SIZE
+#define IPC_INST_2_SHM_SIZE         IPC_SHM_SIZE
+#endif /* IPC_INST_2_SHM_SIZE */
+
+#ifndef IPC_INST_3_SHM_SIZE
+#define IPC_INST_3_SHM_SIZE         IPC_SHM_SIZE
+#endif /* IPC_INST_3_SHM_SIZE */
+
+/* Remote shared memory area size of each instance, holding the M7 TX pools,
+   i.e. the offset of the local area in the instance region. It shall match
+   the local shared memory size configured on the remote core */
+#ifndef IPC_INST_0_REMOTE_SHM_SIZE
+#define IPC_INST_0_REMOTE_SHM_SIZE  IPC_INST_0_SHM_SIZE
+#endif /* IPC_INST_0_REMOTE_SHM_SIZE */
+
+#ifndef IPC_INST_1_REMOTE_SHM_SIZE
+#define IPC_INST_1_REMOTE_SHM_SIZE  IPC_INST_1_SHM_SIZE
+#endif /* IPC_INST_1_REMOTE_SHM_SIZE */
+
+#ifndef IPC_INST_2_REMOTE_SHM_SIZE
+#define IPC_INST_2_REMOTE_SHM_SIZE  IPC_INST_2_SHM_SIZE
+#endif /* IPC_INST_2_REMOTE_SHM_SIZE */
+
+#ifndef IPC_INST_3_REMOTE_SHM_SIZE
+#define IPC_INST_3_REMOTE_SHM_SIZE  IPC_INST_3_SHM_SIZE
+#endif /* IPC_INST_3_REMOTE_SHM_SIZE */
+
+/* Size of the control words of a ring of an IPCF queue, used to locate the
+   TX window pools in the local area. The channels follow each other in
+   configuration order, each managed channel holding its BD queue, sized for
+   all the buffers of its pools, followed by its pools, each one holding its
+   buffer index queue followed by its buffers. It shall match the IPCF
+   version in use, the TX window being disabled if its buffers are not found
+   at the expected place */
+#ifndef IPC_SHM_RING_CTRL_SIZE
+#define IPC_SHM_RING_CTRL_SIZE      8u
+#endif /* IPC_SHM_RING_CTRL_SIZE */
+
+/* A53 RX inter-core interrupt of each instance, shall match the TX interrupt
+   configured on the remote M7 core. Used unless the device tree node of the
+   instance has an nxp,inter-core-rx-irq property. The remote M7 core of an
+   instance is given by the nxp,remote-core property of its node, else by the
+   instance index, so that the nodes need not follow the M7 core order */
+#ifndef IPC_INST_0_RX_IRQ
+#define IPC_INST_0_RX_IRQ           2u
+#endif /* IPC_INST_0_RX_IRQ */
+
+#ifndef IPC_INST_1_RX_IRQ
+#define IPC_INST_1_RX_IRQ           1u
+#endif /* IPC_INST_1_RX_IRQ */
+
+#ifndef IPC_INST_2_RX_IRQ
+#define IPC_INST_2_RX_IRQ           0u
+#endif /* IPC_INST_2_RX_IRQ */
+
+#ifndef IPC_INST_3_RX_IRQ
+#define IPC_INST_3_RX_IRQ           3u
+#endif /* IPC_INST_3_RX_IRQ */
+
+/* M7 core status registers, MC_ME partition 1 core n status */
 #define M7_0_CORE_STAT_REG          0x40088148u
-#define M7_0_CORE_STAT_REG_SIZE     0x4u
-#define M7_0_CORE_ACTIVE            0x1u
+#define M7_CORE_STAT_REG(core)      (M7_0_CORE_STAT_REG + 0x20u * (core))
+#define M7_CORE_STAT_REG_SIZE       0x4u
+#define M7_CORE_ACTIVE              0x1u
 
+#if defined(S32G74A)
+/* Number of M7 cores, each one can be the remote core of an instance */
+#define IPC_NUM_M7_CORES            3u
 #else
-#error "UNKNOWN PLATFORM"
+#define IPC_NUM_M7_CORES            4u
 #endif /* defined(S32G74A) */
 
+#else
+#error "UNKNOWN PLATFORM"
+#endif /* defined(S32G74A) || defined(S32G399A) */
+
 #endif /* __IPCF_MEM_CFG__H__ */
\ No newline at end of file
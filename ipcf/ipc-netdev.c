@@ -0,0 +1,291 @@
+/**
+*   @file       ipc-netdev.c
+*   @brief      Network device front end of the IPCF channels
+*
+*   Each message received on a channel is delivered to the network stack as
+*   a packet, via NAPI, and each transmitted packet is sent as a message. The
+*   payload is opaque to the driver, packets are tagged as ETH_P_802_3 frames
+*   and reach the stack through AF_PACKET sockets, tc and XDP.
+*/
+/* ==========================================================================
+*   (c) Copyright 2022 NXP
+*   All Rights Reserved.
+=============================================================================*/
+#include <linux/kernel.h>
+#include <linux/err.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/if_arp.h>
+#include <linux/if_ether.h>
+#include <linux/timer.h>
+#include <linux/jiffies.h>
+#include <ipc-chardev-kapi.h>
+#include <ipc-netdev.h>
+
+/* ==========================================================================
+ * MACROS AND SYMBOLIC CONSTANTS
+ * ==========================================================================*/
+/* Maximum number of received packets waiting for the NAPI poll */
+#define IPCF_NETDEV_RX_QUEUE_LEN        256u
+
+/* Interval between two attempts to send a packet once the local pools of
+   the channel are exhausted */
+#define IPCF_NETDEV_TX_RETRY_INTERVAL   msecs_to_jiffies(1)
+
+/* ==========================================================================
+ * STRUCTURES AND TYPEDEFS
+ * ==========================================================================*/
+/* Private data of an IPCF network device */
+struct ipcf_netdev_priv {
+    /* Associated network device */
+    struct   net_device *dev;
+    /* NAPI context, delivering the received packets */
+    struct   napi_struct napi;
+    /* Packets received by the IPCF callback, waiting for the NAPI poll */
+    struct   sk_buff_head rx_queue;
+    /* Subscription to the messages of the channel */
+    struct   ipcf_chdev_subscriber sub;
+    /* Restarts the TX queue once stopped on exhausted pools */
+    struct   timer_list tx_retry_timer;
+    /* Associated instance id */
+    uint8_t  instance_id;
+    /* Associated channel id */
+    uint8_t  channel_id;
+};
+
+/* ==========================================================================
+ *                              LOCAL FUNCTIONS
+ * ==========================================================================*/
+/**
+ *  @brief          Queues a message received on the channel for the NAPI poll.
+ *                  Called from the IPCF receive callback.
+ *  @param cb_arg   Pointer to the private data of the network device
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @param buf      Pointer to the payload
+ *  @param size     Payload size
+ *  @return         N/A
+ */
+static void ipcf_netdev_rx_cb(void *cb_arg, uint8_t inst_id, uint8_t chan_id,
+                              const void *buf, size_t size)
+{
+    struct ipcf_netdev_priv *priv = cb_arg;
+    struct net_device *dev = priv->dev;
+    struct sk_buff *skb;
+
+    /* A device being stopped is no longer running, its RX queue is not
+       refilled once purged */
+    if (!netif_running(dev)) {
+        return;
+    }
+    if (skb_queue_len(&priv->rx_queue) >= IPCF_NETDEV_RX_QUEUE_LEN) {
+        dev->stats.rx_dropped++;
+        return;
+    }
+    skb = netdev_alloc_skb(dev, size);
+    if (NULL == skb) {
+        dev->stats.rx_dropped++;
+        return;
+    }
+    skb_put_data(skb, buf, size);
+    skb->protocol = htons(ETH_P_802_3);
+    skb_reset_mac_header(skb);
+    skb_reset_network_header(skb);
+
+    skb_queue_tail(&priv->rx_queue, skb);
+    napi_schedule(&priv->napi);
+}
+
+/**
+ *  @brief          NAPI poll function, delivers the received packets
+ *  @param napi     NAPI context
+ *  @param budget   Maximum number of packets to deliver
+ *  @return         number of delivered packets
+ */
+static int ipcf_netdev_poll(struct napi_struct *napi, int budget)
+{
+    struct ipcf_netdev_priv *priv = container_of(napi, struct ipcf_netdev_priv, napi);
+    struct net_device *dev = priv->dev;
+    struct sk_buff *skb;
+    int done = 0;
+
+    while (done < budget) {
+        skb = skb_dequeue(&priv->rx_queue);
+        if (NULL == skb) {
+            break;
+        }
+        dev->stats.rx_packets++;
+        dev->stats.rx_bytes += skb->len;
+        netif_receive_skb(skb);
+        done++;
+    }
+
+    /* Packets queued after the queue was found empty schedule NAPI again */
+    if (done < budget) {
+        napi_complete_done(napi, done);
+    }
+    return done;
+}
+
+/**
+ *  @brief          Restarts the TX queue, stopped on exhausted pools
+ *  @param t        TX retry timer
+ *  @return         N/A
+ */
+static void ipcf_netdev_tx_retry(struct timer_list *t)
+{
+    struct ipcf_netdev_priv *priv = from_timer(priv, t, tx_retry_timer);
+
+    netif_wake_queue(priv->dev);
+}
+
+/**
+ *  @brief          Sends a packet as a message on the channel
+ *  @param skb      Packet to be sent
+ *  @param dev      Network device
+ *  @return         NETDEV_TX_OK, NETDEV_TX_BUSY if no TX buffer is available
+ */
+static netdev_tx_t ipcf_netdev_start_xmit(struct sk_buff *skb, struct net_device *dev)
+{
+    struct ipcf_netdev_priv *priv = netdev_priv(dev);
+    int err;
+
+    if (skb_linearize(skb)) {
+        dev->stats.tx_dropped++;
+        goto free_skb;
+    }
+
+    err = ipcf_chdev_send(priv->instance_id, priv->channel_id, skb->data, skb->len);
+    if (-EAGAIN == err) {
+        /* The packet is requeued, try again once the remote core had time
+           to free some buffers */
+        netif_stop_queue(dev);
+        mod_timer(&priv->tx_retry_timer, jiffies + IPCF_NETDEV_TX_RETRY_INTERVAL);
+        return NETDEV_TX_BUSY;
+    }
+    if (err) {
+        dev->stats.tx_errors++;
+        goto free_skb;
+    }
+    dev->stats.tx_packets++;
+    dev->stats.tx_bytes += skb->len;
+
+free_skb:
+    dev_kfree_skb_any(skb);
+    return NETDEV_TX_OK;
+}
+
+/**
+ *  @brief          Brings the network device up, subscribing to the channel
+ *  @param dev      Network device
+ *  @return         0 on success, error code of the subscription otherwise
+ */
+static int ipcf_netdev_open(struct net_device *dev)
+{
+    struct ipcf_netdev_priv *priv = netdev_priv(dev);
+    int err;
+
+    napi_enable(&priv->napi);
+    err = ipcf_chdev_subscribe(priv->instance_id, priv->channel_id, &priv->sub);
+    if (err) {
+        napi_disable(&priv->napi);
+        return err;
+    }
+    netif_start_queue(dev);
+    return 0;
+}
+
+/**
+ *  @brief          Brings the network device down
+ *  @param dev      Network device
+ *  @return         0
+ */
+static int ipcf_netdev_stop(struct net_device *dev)
+{
+    struct ipcf_netdev_priv *priv = netdev_priv(dev);
+
+    netif_stop_queue(dev);
+    del_timer_sync(&priv->tx_retry_timer);
+    /* No receive callback runs once unsubscribed, then no poll once NAPI is
+       disabled: nothing can queue a packet after the purge */
+    ipcf_chdev_unsubscribe(&priv->sub);
+    napi_disable(&priv->napi);
+    skb_queue_purge(&priv->rx_queue);
+    return 0;
+}
+
+/* Network device operations */
+static const struct net_device_ops ipcf_netdev_ops = {
+    .ndo_open       = ipcf_netdev_open,
+    .ndo_stop       = ipcf_netdev_stop,
+    .ndo_start_xmit = ipcf_netdev_start_xmit,
+};
+
+/**
+ *  @brief          Initializes a network device, point to point link without
+ *                  link layer header
+ *  @param dev      Network device
+ *  @return         N/A
+ */
+static void ipcf_netdev_setup(struct net_device *dev)
+{
+    dev->netdev_ops = &ipcf_netdev_ops;
+    dev->type = ARPHRD_NONE;
+    dev->flags = IFF_POINTOPOINT | IFF_NOARP;
+    dev->hard_header_len = 0;
+    dev->addr_len = 0;
+    dev->tx_queue_len = 1000;
+    dev->needs_free_netdev = true;
+}
+
+/* ==========================================================================
+ *                              GLOBAL FUNCTIONS
+ * ==========================================================================*/
+/**
+ *  @brief          Creates and registers the network device of a channel, see
+ *                  ipc-netdev.h
+ */
+struct net_device *ipcf_netdev_create(uint8_t inst_id, uint8_t chan_id, uint32_t mtu)
+{
+    struct net_device *dev;
+    struct ipcf_netdev_priv *priv;
+    int err;
+
+    dev = alloc_netdev(sizeof(*priv), IPCF_NETDEV_NAME, NET_NAME_ENUM, ipcf_netdev_setup);
+    if (NULL == dev) {
+        return ERR_PTR(-ENOMEM);
+    }
+    dev->mtu = mtu;
+    dev->min_mtu = 1;
+    dev->max_mtu = mtu;
+
+    priv = netdev_priv(dev);
+    priv->dev = dev;
+    priv->instance_id = inst_id;
+    priv->channel_id = chan_id;
+    priv->sub.rx_cb = ipcf_netdev_rx_cb;
+    priv->sub.cb_arg = priv;
+    skb_queue_head_init(&priv->rx_queue);
+    timer_setup(&priv->tx_retry_timer, ipcf_netdev_tx_retry, 0);
+    netif_napi_add(dev, &priv->napi, ipcf_netdev_poll, NAPI_POLL_WEIGHT);
+
+    err = register_netdev(dev);
+    if (err) {
+        netif_napi_del(&priv->napi);
+        free_netdev(dev);
+        return ERR_PTR(err);
+    }
+    return dev;
+}
+
+/**
+ *  @brief          Unregisters and frees the network device of a channel, see
+ *                  ipc-netdev.h
+ */
+void ipcf_netdev_destroy(struct net_device *dev)
+{
+    if (NULL != dev) {
+        /* Stops the device if up, then frees it via needs_free_netdev */
+        unregister_netdev(dev);
+    }
+}
@@ -0,0 +1,34 @@
+/**
+*   @file       ipc-netdev.h
+*   @brief      Network device front end of the IPCF channels
+*/
+/* ==========================================================================
+*   (c) Copyright 2022 NXP
+*   All Rights Reserved.
+=============================================================================*/
+#ifndef __IPCF_NETDEV__H__
+#define __IPCF_NETDEV__H__
+
+#include <linux/types.h>
+#include <linux/netdevice.h>
+
+/* Name of the network devices, enumerated by the kernel */
+#define IPCF_NETDEV_NAME                "ipcf%d"
+
+/**
+ *  @brief          Creates and registers the network device of a channel
+ *  @param inst_id  Instance id
+ *  @param chan_id  Channel id
+ *  @param mtu      Maximum message size of the channel
+ *  @return         pointer to the network device, ERR_PTR on error
+ */
+struct net_device *ipcf_netdev_create(uint8_t inst_id, uint8_t chan_id, uint32_t mtu);
+
+/**
+ *  @brief          Unregisters and frees the network device of a channel
+ *  @param dev      Pointer to the network device, may be NULL
+ *  @return         N/A
+ */
+void ipcf_netdev_destroy(struct net_device *dev);
+
+#endif /* __IPCF_NETDEV__H__ */
@@ -0,0 +1,555 @@
+/**
+*   @file       ipcf-bench.c
+*   @brief      Echo loopback benchmark of the IPCF character devices
+*
+*   Sends messages on a channel echoed by the remote core and measures the
+*   round-trip time of each one, through one of the I/O modes of the driver:
+*    - rw:    blocking write, then blocking read of the echo
+*    - poll:  non-blocking write, poll, then read of the pending echoes
+*    - mmap:  non-blocking write, poll, then in place processing of the
+*             pending echoes in the mapped RX ring, consumed via
+*             IPCF_IOC_RX_CONSUME
+*    - batch: as mmap, all the messages fitting in the window being sent by
+*             a single writev
+*   Up to window messages are in flight, except in rw mode, which waits for
+*   each echo without timeout. The results are printed as "<key> <value>"
+*   lines, using the same keys as the in-kernel benchmark driven via
+*   /sys/kernel/debug/ipcfshm/<instance>!<channel>/echo_bench.
+*
+*   Each message starts with its sequence number and the run tag, in
+*   little-endian byte order, other messages received on the channel are
+*   ignored.
+*/
+/* ==========================================================================
+*   (c) Copyright 2022 NXP
+*   All Rights Reserved.
+=============================================================================*/
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <endian.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <ipc-chardev.h>
+
+/* ==========================================================================
+ * MACROS AND SYMBOLIC CONSTANTS
+ * ==========================================================================*/
+/* Default channel, echoed by the M7 core */
+#define BENCH_DEFAULT_DEV               "/dev/ipcfshm/M7_0/echo"
+
+/* Size of the message header, sequence number and run tag */
+#define BENCH_HDR_SIZE                  (2 * sizeof(uint32_t))
+
+/* Maximum number of messages in flight */
+#define BENCH_MAX_WINDOW                IPCF_TX_WINDOW_MAX_BUFS
+
+/* Maximum message size */
+#define BENCH_MAX_SIZE                  65536u
+
+/* Time to wait for the echo of an in flight message before aborting, in ms */
+#define BENCH_TIMEOUT_MS                1000
+
+/* Delay before retrying a write, once the TX buffers are exhausted, in us */
+#define BENCH_TX_RETRY_US               10
+
+/* ==========================================================================
+ * STRUCTURES AND TYPEDEFS
+ * ==========================================================================*/
+/* I/O modes */
+enum bench_mode {
+    BENCH_MODE_RW,
+    BENCH_MODE_POLL,
+    BENCH_MODE_MMAP,
+    BENCH_MODE_BATCH,
+};
+
+/* State of a run */
+struct bench {
+    /* I/O mode */
+    enum     bench_mode mode;
+    /* Channel file descriptor */
+    int      fd;
+    /* Requested number of messages, message size, maximum in flight */
+    uint32_t msgs;
+    uint32_t size;
+    uint32_t window;
+    /* Run tag, tells apart other messages */
+    uint32_t tag;
+    /* Messages sent and echoed */
+    uint32_t sent;
+    uint32_t received;
+    /* Writes retried as no TX buffer was available */
+    uint64_t tx_retries;
+    /* Per message send time, replaced by the round-trip time once echoed */
+    uint64_t *samples;
+    /* Per message flag, set once echoed */
+    bool     *echoed;
+    /* Messages to be sent, one per window slot */
+    uint8_t  *tx_bufs;
+    /* Buffer receiving a message, in rw and poll modes */
+    uint8_t  *rx_buf;
+    /* Mapped RX ring, in mmap and batch modes */
+    uint8_t  *ring;
+    struct   ipcf_rx_ring_info ring_info;
+};
+
+/* Names of the I/O modes, indexed by mode */
+static const char *const mode_names[] = {
+    [BENCH_MODE_RW]    = "rw",
+    [BENCH_MODE_POLL]  = "poll",
+    [BENCH_MODE_MMAP]  = "mmap",
+    [BENCH_MODE_BATCH] = "batch",
+};
+
+/* ==========================================================================
+ *                              LOCAL FUNCTIONS
+ * ==========================================================================*/
+/**
+ *  @brief          Gets the monotonic time
+ *  @return         time in ns
+ */
+static uint64_t get_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ *  @brief          Records the round-trip time of a received message, if it
+ *                  is the echo of an in flight message of the run
+ *  @param b        Pointer to the run state
+ *  @param buf      Pointer to the payload
+ *  @param size     Payload size
+ *  @return         N/A
+ */
+static void record_echo(struct bench *b, const uint8_t *buf, uint32_t size)
+{
+    uint64_t now = get_time_ns();
+    uint32_t seq;
+    uint32_t tag;
+
+    if (size < BENCH_HDR_SIZE) {
+        return;
+    }
+    memcpy(&seq, buf, sizeof(seq));
+    memcpy(&tag, buf + sizeof(seq), sizeof(tag));
+    seq = le32toh(seq);
+    if ((le32toh(tag) != b->tag) || (seq >= b->sent) || b->echoed[seq]) {
+        return;
+    }
+    b->echoed[seq] = true;
+    b->samples[seq] = now - b->samples[seq];
+    b->received++;
+}
+
+/**
+ *  @brief          Sends the messages fitting in the window
+ *  @param b        Pointer to the run state
+ *  @return         0 on success, -errno on error
+ */
+static int send_msgs(struct bench *b)
+{
+    struct iovec iov[BENCH_MAX_WINDOW];
+    uint32_t count = 0;
+    uint32_t seq;
+    uint32_t seq_le;
+    uint32_t idx;
+    ssize_t ret;
+
+    while (((b->sent + count) < b->msgs) && ((b->sent + count - b->received) < b->window)) {
+        seq = b->sent + count;
+        iov[count].iov_base = b->tx_bufs + (seq % b->window) * b->size;
+        iov[count].iov_len = b->size;
+        seq_le = htole32(seq);
+        memcpy(iov[count].iov_base, &seq_le, sizeof(seq_le));
+        count++;
+        /* Other modes send one message per write */
+        if (BENCH_MODE_BATCH != b->mode) {
+            break;
+        }
+    }
+
+    while (count > 0) {
+        for (idx = 0; idx < count; idx++) {
+            b->samples[b->sent + idx] = get_time_ns();
+        }
+        ret = writev(b->fd, iov, count);
+        if (ret < 0) {
+            if (EAGAIN != errno) {
+                return -errno;
+            }
+            b->tx_retries++;
+            usleep(BENCH_TX_RETRY_US);
+            continue;
+        }
+        /* Each buffer is sent as a message */
+        ret /= b->size;
+        b->sent += ret;
+        memmove(iov, iov + ret, (count - ret) * sizeof(iov[0]));
+        count -= ret;
+    }
+    return 0;
+}
+
+/**
+ *  @brief          Waits until the channel is readable
+ *  @param b        Pointer to the run state
+ *  @return         0 on success, -ETIMEDOUT if no message was received in
+ *                  time, -errno on error
+ */
+static int wait_msgs(struct bench *b)
+{
+    struct pollfd pfd = { .fd = b->fd, .events = POLLIN };
+    int ret = poll(&pfd, 1, BENCH_TIMEOUT_MS);
+
+    if (ret < 0) {
+        return -errno;
+    }
+    return (0 == ret) ? -ETIMEDOUT : 0;
+}
+
+/**
+ *  @brief          Reads the pending messages via read
+ *  @param b        Pointer to the run state
+ *  @param block    Waits for one message, on blocking files
+ *  @return         0 on success, -errno on error
+ */
+static int read_msgs(struct bench *b, bool block)
+{
+    ssize_t ret;
+
+    do {
+        ret = read(b->fd, b->rx_buf, BENCH_MAX_SIZE);
+        if (0 == ret) {
+            return 0;
+        }
+        if (ret < 0) {
+            return (EAGAIN == errno) ? 0 : -errno;
+        }
+        record_echo(b, b->rx_buf, ret);
+    } while (!block);
+    return 0;
+}
+
+/**
+ *  @brief          Processes the pending messages in place in the mapped RX
+ *                  ring, then consumes them
+ *  @param b        Pointer to the run state
+ *  @return         0 on success, -errno on error
+ */
+static int consume_msgs(struct bench *b)
+{
+    const struct ipcf_rx_ring_hdr *hdr = (const struct ipcf_rx_ring_hdr *)b->ring;
+    const struct ipcf_rx_slot_hdr *slot;
+    const struct ipcf_rx_slot_hdr *entry;
+    const struct ipcf_rx_slot_ref *ref;
+    uint32_t store_seq = 0;
+    struct ipcf_rx_cursor cursor;
+    uint8_t msg_hdr[BENCH_HDR_SIZE];
+    uint32_t size;
+    uint32_t idx;
+
+    /* The ioctl orders the reads of the slots after the producer update */
+    if (ioctl(b->fd, IPCF_IOC_RX_CURSOR, &cursor)) {
+        return -errno;
+    }
+    for (idx = cursor.cursor; idx != (cursor.cursor + cursor.pending); idx++) {
+        slot = (const struct ipcf_rx_slot_hdr *)(b->ring + hdr->slots_offset +
+               (idx & (hdr->num_slots - 1)) * hdr->slot_size);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != idx) {
+            continue;
+        }
+        size = slot->size;
+        entry = NULL;
+        if ((hdr->flags & IPCF_RX_RING_F_FRAG_STORE) &&
+            (size > (hdr->slot_size - sizeof(*slot)))) {
+            /* The payload is kept in the fragmentation store */
+            ref = (const struct ipcf_rx_slot_ref *)(slot + 1);
+            store_seq = ref->seq;
+            if (ref->offset > (b->ring_info.map_size - sizeof(*entry) - sizeof(msg_hdr))) {
+                continue;
+            }
+            entry = (const struct ipcf_rx_slot_hdr *)(b->ring + ref->offset);
+            memcpy(msg_hdr, entry + 1, sizeof(msg_hdr));
+        } else {
+            memcpy(msg_hdr, slot + 1, sizeof(msg_hdr));
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        /* Skip the stale content of a slot or store entry overwritten in the
+           meantime */
+        if ((__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == idx) &&
+            ((NULL == entry) || (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) == store_seq)) &&
+            (size <= b->ring_info.max_msg_size)) {
+            record_echo(b, msg_hdr, size);
+        }
+    }
+    if ((0 != cursor.pending) && ioctl(b->fd, IPCF_IOC_RX_CONSUME, &cursor.pending)) {
+        return -errno;
+    }
+    return 0;
+}
+
+/**
+ *  @brief          Discards the messages pending on the channel before the
+ *                  run
+ *  @param b        Pointer to the run state
+ *  @return         0 on success, -errno on error
+ */
+static int drain_msgs(struct bench *b)
+{
+    int flags = fcntl(b->fd, F_GETFL);
+    int err;
+
+    if ((BENCH_MODE_MMAP == b->mode) || (BENCH_MODE_BATCH == b->mode)) {
+        return consume_msgs(b);
+    }
+    if ((flags < 0) || (fcntl(b->fd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+        return -errno;
+    }
+    err = read_msgs(b, false);
+    if (fcntl(b->fd, F_SETFL, flags) < 0) {
+        return -errno;
+    }
+    return err;
+}
+
+/**
+ *  @brief          Sends the messages of the run and waits for their echoes
+ *  @param b        Pointer to the run state
+ *  @return         0 if all messages were echoed, -ETIMEDOUT if an echo is
+ *                  missing, -errno on error
+ */
+static int run_exchange(struct bench *b)
+{
+    int err = 0;
+
+    while ((0 == err) && (b->received < b->msgs)) {
+        err = send_msgs(b);
+        if (0 != err) {
+            break;
+        }
+        switch (b->mode) {
+        case BENCH_MODE_RW:
+            err = read_msgs(b, true);
+            break;
+        case BENCH_MODE_POLL:
+            err = wait_msgs(b);
+            if (0 == err) {
+                err = read_msgs(b, false);
+            }
+            break;
+        default:
+            err = wait_msgs(b);
+            if (0 == err) {
+                err = consume_msgs(b);
+            }
+            break;
+        }
+    }
+    return err;
+}
+
+/**
+ *  @brief          Compares two round-trip times, for qsort
+ *  @param a        Pointer to the first time
+ *  @param b        Pointer to the second time
+ *  @return         <0, 0, >0 if a is lower, equal or greater than b
+ */
+static int cmp_rtt(const void *a, const void *b)
+{
+    uint64_t rtt_a = *(const uint64_t *)a;
+    uint64_t rtt_b = *(const uint64_t *)b;
+
+    return (rtt_a > rtt_b) - (rtt_a < rtt_b);
+}
+
+/**
+ *  @brief          Prints the results of the run
+ *  @param b        Pointer to the run state
+ *  @param status   Error code of the run
+ *  @param duration Time from the first send until the last echo, in ns
+ *  @return         N/A
+ */
+static void print_results(struct bench *b, int status, uint64_t duration)
+{
+    uint64_t *rtt = b->samples;
+    uint64_t msgs_per_s = 0;
+    uint64_t sum = 0;
+    uint32_t count = 0;
+    uint32_t idx;
+
+    /* Keep the round-trip times only, in place */
+    for (idx = 0; idx < b->sent; idx++) {
+        if (b->echoed[idx]) {
+            rtt[count++] = rtt[idx];
+        }
+    }
+    qsort(rtt, count, sizeof(rtt[0]), cmp_rtt);
+    for (idx = 0; idx < count; idx++) {
+        sum += rtt[idx];
+    }
+    if (0 != duration) {
+        msgs_per_s = (uint64_t)b->received * 1000000000ull / duration;
+    }
+
+    printf("mode %s\n", mode_names[b->mode]);
+    printf("status %d\n", status);
+    printf("msgs %u\n", b->msgs);
+    printf("size %u\n", b->size);
+    printf("window %u\n", b->window);
+    printf("sent %u\n", b->sent);
+    printf("received %u\n", b->received);
+    printf("tx_retries %llu\n", (unsigned long long)b->tx_retries);
+    printf("duration_ns %llu\n", (unsigned long long)duration);
+    printf("msgs_per_s %llu\n", (unsigned long long)msgs_per_s);
+    printf("bytes_per_s %llu\n", (unsigned long long)(msgs_per_s * b->size));
+    printf("rtt_min_ns %llu\n", (unsigned long long)(count ? rtt[0] : 0));
+    printf("rtt_mean_ns %llu\n", (unsigned long long)(count ? sum / count : 0));
+    printf("rtt_p50_ns %llu\n", (unsigned long long)(count ? rtt[(count - 1) * 500ull / 1000] : 0));
+    printf("rtt_p90_ns %llu\n", (unsigned long long)(count ? rtt[(count - 1) * 900ull / 1000] : 0));
+    printf("rtt_p99_ns %llu\n", (unsigned long long)(count ? rtt[(count - 1) * 990ull / 1000] : 0));
+    printf("rtt_p999_ns %llu\n", (unsigned long long)(count ? rtt[(count - 1) * 999ull / 1000] : 0));
+    printf("rtt_max_ns %llu\n", (unsigned long long)(count ? rtt[count - 1] : 0));
+}
+
+/**
+ *  @brief          Prints the usage information
+ *  @param name     Program name
+ *  @return         N/A
+ */
+static void usage(const char *name)
+{
+    printf("Usage: %s [options]\n"
+           "OPTIONS:\n"
+           "        -d <device>     Channel echoed by the remote core, default %s\n"
+           "        -m <mode>       I/O mode: rw, poll, mmap or batch, default rw\n"
+           "        -n <messages>   Number of messages, default 10000\n"
+           "        -s <bytes>      Message size, from %zu to the channel buffer size, default 64\n"
+           "        -w <messages>   Maximum number of messages in flight, up to %u, default 1\n"
+           "        -h              Print this help\n",
+           name, BENCH_DEFAULT_DEV, BENCH_HDR_SIZE, BENCH_MAX_WINDOW);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dev = BENCH_DEFAULT_DEV;
+    struct bench b = { .mode = BENCH_MODE_RW, .msgs = 10000, .size = 64, .window = 1 };
+    uint64_t start;
+    uint32_t tag_le;
+    uint32_t idx;
+    int flags = O_RDWR;
+    int opt;
+    int err;
+
+    while ((opt = getopt(argc, argv, "d:m:n:s:w:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            dev = optarg;
+            break;
+        case 'm':
+            for (idx = 0; idx < (sizeof(mode_names) / sizeof(mode_names[0])); idx++) {
+                if (0 == strcmp(optarg, mode_names[idx])) {
+                    break;
+                }
+            }
+            if (idx == (sizeof(mode_names) / sizeof(mode_names[0]))) {
+                fprintf(stderr, "Invalid mode %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            b.mode = (enum bench_mode)idx;
+            break;
+        case 'n':
+            b.msgs = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            b.size = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            b.window = strtoul(optarg, NULL, 0);
+            break;
+        case 'h':
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((0 == b.msgs) || (b.size < BENCH_HDR_SIZE) || (b.size > BENCH_MAX_SIZE) ||
+        (0 == b.window) || (b.window > BENCH_MAX_WINDOW)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    /* One message in flight, waiting for each echo in read */
+    if (BENCH_MODE_RW == b.mode) {
+        b.window = 1;
+    } else {
+        flags |= O_NONBLOCK;
+    }
+
+    b.fd = open(dev, flags);
+    if (b.fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", dev, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    b.samples = calloc(b.msgs, sizeof(b.samples[0]));
+    b.echoed = calloc(b.msgs, sizeof(b.echoed[0]));
+    b.tx_bufs = calloc(b.window, b.size);
+    b.rx_buf = malloc(BENCH_MAX_SIZE);
+    if ((NULL == b.samples) || (NULL == b.echoed) || (NULL == b.tx_bufs) || (NULL == b.rx_buf)) {
+        fprintf(stderr, "Failed to allocate the run buffers\n");
+        return EXIT_FAILURE;
+    }
+    if (ioctl(b.fd, IPCF_IOC_RX_RING_INFO, &b.ring_info)) {
+        fprintf(stderr, "Failed to get the RX ring geometry: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    /* Larger messages would be truncated */
+    if (b.size > b.ring_info.max_msg_size) {
+        fprintf(stderr, "Message size exceeds the channel buffers, %u bytes\n",
+                b.ring_info.max_msg_size);
+        return EXIT_FAILURE;
+    }
+    if ((BENCH_MODE_MMAP == b.mode) || (BENCH_MODE_BATCH == b.mode)) {
+        if (b.ring_info.flags & IPCF_RX_RING_F_DEFERRED) {
+            fprintf(stderr, "Channels using deferred release are not supported\n");
+            return EXIT_FAILURE;
+        }
+        b.ring = mmap(NULL, b.ring_info.map_size, PROT_READ, MAP_SHARED, b.fd, 0);
+        if (MAP_FAILED == b.ring) {
+            fprintf(stderr, "Failed to map the RX ring: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    /* The payload past the header is a byte counter */
+    for (idx = 0; idx < (b.window * b.size); idx++) {
+        b.tx_bufs[idx] = (uint8_t)(idx % b.size);
+    }
+    b.tag = (uint32_t)getpid();
+    tag_le = htole32(b.tag);
+    for (idx = 0; idx < b.window; idx++) {
+        memcpy(b.tx_bufs + idx * b.size + sizeof(uint32_t), &tag_le, sizeof(tag_le));
+    }
+
+    err = drain_msgs(&b);
+    if (0 != err) {
+        fprintf(stderr, "Failed to discard the pending messages: %s\n", strerror(-err));
+        return EXIT_FAILURE;
+    }
+    start = get_time_ns();
+    err = run_exchange(&b);
+    print_results(&b, err, get_time_ns() - start);
+
+    return (0 == err) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
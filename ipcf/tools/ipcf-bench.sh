@@ -0,0 +1,140 @@
+#!/bin/bash
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Copyright 2022 NXP
+
+# This script runs the IPCF echo loopback benchmark over the in-kernel mode and the I/O modes of
+# the ipcf-bench tool, for a set of message sizes, and prints one CSV line per run, so that the
+# results of two releases can be compared.
+
+set -Ee
+
+# Channel echoed by the M7 core
+device=/dev/ipcfshm/M7_0/echo
+
+# debugfs file of the in-kernel benchmark of the channel
+bench_file=/sys/kernel/debug/ipcfshm/M7_0!echo/echo_bench
+
+# Number of messages of each run
+msgs=10000
+
+# Message sizes in bytes
+sizes="8 64 256 1024"
+
+# Maximum number of messages in flight, except in rw mode
+window=8
+
+# Modes to be run, "kernel" being the in-kernel benchmark
+modes="kernel rw poll mmap batch"
+
+# Result keys, in CSV column order
+readonly keys="mode status msgs size window sent received tx_retries duration_ns msgs_per_s \
+bytes_per_s rtt_min_ns rtt_mean_ns rtt_p50_ns rtt_p90_ns rtt_p99_ns rtt_p999_ns rtt_max_ns"
+
+readonly integer_regex="^[0-9]+$"
+
+# Print usage information
+usage() {
+        echo -e "Usage: ./$(basename "$0") [options]
+OPTIONS:
+        -d | --device <path>        Channel echoed by the M7 core, default ${device}
+        -b | --bench-file <path>    debugfs file of the in-kernel benchmark, default ${bench_file}
+        -n | --msgs <count>         Number of messages of each run, default ${msgs}
+        -s | --sizes <list>         Quoted list of message sizes in bytes, default \"${sizes}\"
+        -w | --window <count>       Maximum number of messages in flight, default ${window}
+        -m | --modes <list>         Quoted list of modes among kernel, rw, poll, mmap and batch
+        -h | --help                 Help
+"
+}
+
+# Parse the command line arguments
+check_input() {
+        while [[ $# -gt 0 ]]; do
+                case "${1}" in
+                        -d|--device)
+                                device="${2}"
+                                shift 2
+                                ;;
+                        -b|--bench-file)
+                                bench_file="${2}"
+                                shift 2
+                                ;;
+                        -n|--msgs)
+                                msgs="${2}"
+                                if ! [[ "${msgs}" =~ ${integer_regex} ]]; then
+                                        echo "Number of messages must be a positive integer number"
+                                        exit 1
+                                fi
+                                shift 2
+                                ;;
+                        -s|--sizes)
+                                sizes="${2}"
+                                shift 2
+                                ;;
+                        -w|--window)
+                                window="${2}"
+                                if ! [[ "${window}" =~ ${integer_regex} ]]; then
+                                        echo "Window must be a positive integer number"
+                                        exit 1
+                                fi
+                                shift 2
+                                ;;
+                        -m|--modes)
+                                modes="${2}"
+                                shift 2
+                                ;;
+                        -h|--help)
+                                usage
+                                exit 0
+                                ;;
+                        *)
+                                echo "$0: Invalid option $1"
+                                usage
+                                exit 1
+                                ;;
+                esac
+        done
+}
+
+# Run the in-kernel benchmark, printing its "<key> <value>" results
+run_kernel() {
+        local size="${1}"
+
+        # The write returns once the run is over, its results are kept on failure as well
+        echo "${msgs} ${size} ${window}" > "${bench_file}" || true
+        cat "${bench_file}"
+}
+
+# Run the user space benchmark in the given mode, printing its "<key> <value>" results
+run_tool() {
+        local mode="${1}"
+        local size="${2}"
+
+        "$(dirname "$0")/ipcf-bench" -d "${device}" -m "${mode}" -n "${msgs}" -s "${size}" \
+                -w "${window}" || true
+}
+
+# Convert "<key> <value>" lines to a CSV line, in the column order of the keys
+to_csv() {
+        awk -v keys="${keys}" '
+                { value[$1] = $2 }
+                END {
+                        n = split(keys, k, " ")
+                        for (i = 1; i <= n; i++) {
+                                printf "%s%s", value[k[i]], (i < n) ? "," : "\n"
+                        }
+                }'
+}
+
+check_input "$@"
+
+echo "${keys}" | tr -s ' ' ','
+for size in ${sizes}; do
+        for mode in ${modes}; do
+                if [ "${mode}" = "kernel" ]; then
+                        run_kernel "${size}" | to_csv
+                else
+                        run_tool "${mode}" "${size}" | to_csv
+                fi
+        done
+done